@@ -0,0 +1,645 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <Eigen/Sparse>
+#include "EliminationTree.h"
+
+// Eigen's simplicial LDL^T, extended with modifications of the numeric factor in place.
+// The factor is of P * A * P^T, L is unit lower triangular and stored without its diagonal,
+// the row indices of each column are ascending, thus the first one is the parent in the elimination tree.
+// With several threads (OpenMP), the independent subtrees of the elimination tree are factored and solved
+// concurrently, the results are bitwise identical for any number of threads.
+template<class MatrixType>
+class CholeskyFactor : public Eigen::SimplicialLDLT<MatrixType>
+{
+public:
+	typedef Eigen::SimplicialLDLT<MatrixType> Base;
+	typedef typename MatrixType::Scalar Scalar;
+	typedef typename MatrixType::StorageIndex StorageIndex;
+	// a level of the top narrower than this or the threads goes serially in solveLevels(), as it hardly pays the barrier
+	enum { LEVEL_MIN_WIDTH = 4 };
+public:
+	CholeskyFactor() {}
+	~CholeskyFactor() {}
+
+	// the threads of factorize() and solveLevels(), from 2 their schedules are computed by the first factorize()
+	// of each analyzed pattern, and stay valid for the in-place modifications, which keep the pattern
+	void setNumThreads(int nThreads)
+	{
+		if (nThreads != m_nThreads)
+		{
+			m_subtreesValid = false;
+			m_levelsValid = false;
+		}
+		m_nThreads = nThreads;
+	}
+	bool hasSolveLevels()const { return m_levelsValid; }
+
+	void analyzePattern(const MatrixType& a)
+	{
+		Base::analyzePattern(a);
+		m_subtreesValid = false;
+		m_levelsValid = false;
+	}
+
+	// The up-looking rows of SimplicialLDLT::factorize(). Row k of L only reads the columns of its descendants
+	// in the elimination tree and only writes to them, thus the rows of independent subtrees are computed
+	// concurrently, then those of the top above them in order. Each column gets the same rows in the same order
+	// as in the serial sweep, thus the factor does not depend on the number of threads.
+	void factorize(const MatrixType& a);
+
+	// the position of the unknown i in the factored order
+	int permutedIndex(int i)const
+	{
+		return Base::m_P.size() > 0 ? (int)Base::m_P.indices()[i] : i;
+	}
+
+	// Analyze a of the same pattern as the matrix of another factor, taking its fill-reducing ordering,
+	// thus only the elimination tree and column counts are computed. Then only factorize() is needed.
+	void analyzePattern(const MatrixType& a, const CholeskyFactor& other)
+	{
+		Base::m_P = other.m_P;
+		Base::m_Pinv = other.m_Pinv;
+		typename Base::CholMatrixType ap(a.rows(), a.cols());
+		if (Base::m_P.size() > 0)
+			ap.template selfadjointView<Eigen::Upper>() = a.template selfadjointView<Base::UpLo>().twistedBy(Base::m_P);
+		else
+			ap.template selfadjointView<Eigen::Upper>() = a.template selfadjointView<Base::UpLo>();
+		Base::analyzePattern_preordered(ap, true);
+		m_subtreesValid = false;
+		m_levelsValid = false;
+	}
+
+	// Solve A * X = B for a B that is nonzero only in the given rows (original order). L^-1 * B is nonzero
+	// only on the elimination-tree reach of those rows, thus the forward substitution only visits the reach,
+	// the backward substitution fills all of X anyway. B, X and the buffer Y are n x c row-major.
+	template<class MatR>
+	void solveSparseRhs(const std::vector<int>& rows, const MatR& B, MatR& X, MatR& Y)const;
+
+	// A * X = B on the threads of setNumThreads(). In L * z = y row k only needs its descendants in the elimination
+	// tree, in L^T * x = w column k only its ancestors, thus independent subtrees are solved concurrently, then the
+	// top of the tree above them by levels: those of the same height are independent, the narrow ones go serially.
+	// The rows of the top gather much of L * z = y from the subtrees, their leading entries in the subtrees go in
+	// parallel before. Each entry of L is applied in the order of the serial sweeps, thus X is bitwise identical
+	// for any number of threads. B and X are n x c, the buffer Y is row-major. Needs hasSolveLevels().
+	template<class Mat, class MatR>
+	void solveLevels(const Mat& B, MatR& Y, Mat& X)const;
+
+	// Given the factor of A, refactor A + sigma * w * w^T in place, sigma < 0 is a downdate.
+	// w is in the original order of A. Only the columns on the elimination tree paths from the nonzeros
+	// of w are touched, e.g. a single path of ~log(n) columns for w = e_i, the pattern of L is unchanged.
+	// Returns NumericalIssue if a downdate makes the matrix not positive definite, the factor is then invalid.
+	Eigen::ComputationInfo rankUpdate(const Eigen::SparseVector<Scalar>& w, Scalar sigma);
+
+	// Given the factor of a matrix of the same pattern as a, refactor a in place, where only the entries of a
+	// among the given unknowns (original order) changed. Only the rows and columns of L on the elimination tree
+	// paths from those unknowns to the root change, thus only the rows on the paths are computed again,
+	// up-looking as SimplicialLDLT::factorize(). Returns NumericalIssue on a zero pivot, the factor is then invalid.
+	Eigen::ComputationInfo refactorize(const MatrixType& a, const std::vector<int>& changed);
+protected:
+	void analyzeSubtrees();
+	void analyzeLevels();
+	bool factorizeRow(int k, const typename Base::CholMatrixType& ap, Scalar* y, int* pattern, int* tags);
+private:
+	std::vector<Scalar> m_w;			// dense workspace of the permuted w, zero between calls
+	std::vector<int> m_mark;
+	std::vector<int> m_path;
+
+	// for factorize() and solveLevels()
+	int m_nThreads = 1;
+	bool m_subtreesValid = false;
+	std::vector<char> m_isTop;			// the unknowns above the independent subtrees
+	std::vector<int> m_subtreeStart, m_subtreeNodes;	// the independent subtrees, heaviest first, each ascending
+	bool m_levelsValid = false;
+	std::vector<int> m_rowStart;		// the pattern of L by rows: the columns and positions in Lx of row i
+	std::vector<int> m_rowCols, m_rowPos;	// at [m_rowStart[i], m_rowStart[i + 1]), the columns ascending
+	std::vector<int> m_rowTopStart;		// in a row of the top, the first column of the top
+	std::vector<int> m_levelStart, m_levelNodes;	// the top by ascending height, the narrow heights merged
+	std::vector<char> m_levelParallel;
+};
+
+template<class MatrixType>
+void CholeskyFactor<MatrixType>::analyzeSubtrees()
+{
+	const int n = (int)Base::m_matrix.cols();
+	const StorageIndex* Lp = Base::m_matrix.outerIndexPtr();
+	const StorageIndex* parent = Base::m_parent.data();
+
+	// the work of each subtree by the entries of its columns, known from the analysis, a parent is after its children
+	std::vector<double> work(n);
+	for (int j = 0; j < n; j++)
+		work[j] = 1 + Lp[j + 1] - Lp[j];
+	for (int j = 0; j < n; j++)
+		if (parent[j] >= 0)
+			work[parent[j]] += work[j];
+	std::vector<int> roots;
+	splitSubtrees(parent, n, work, m_nThreads, roots, m_isTop);
+
+	// the unknowns of each subtree, ascending
+	std::vector<int> subtree(n, -1);
+	for (size_t t = 0; t < roots.size(); t++)
+		subtree[roots[t]] = (int)t;
+	for (int j = n - 1; j >= 0; j--)
+		if (!m_isTop[j] && subtree[j] < 0)
+			subtree[j] = subtree[parent[j]];
+	m_subtreeStart.assign(roots.size() + 1, 0);
+	for (int j = 0; j < n; j++)
+		if (subtree[j] >= 0)
+			m_subtreeStart[subtree[j] + 1]++;
+	for (size_t t = 0; t < roots.size(); t++)
+		m_subtreeStart[t + 1] += m_subtreeStart[t];
+	m_subtreeNodes.resize(m_subtreeStart.back());
+	std::vector<int> pos(m_subtreeStart.begin(), m_subtreeStart.end() - 1);
+	for (int j = 0; j < n; j++)
+		if (subtree[j] >= 0)
+			m_subtreeNodes[pos[subtree[j]]++] = j;
+	m_subtreesValid = true;
+}
+
+template<class MatrixType>
+void CholeskyFactor<MatrixType>::factorize(const MatrixType& a)
+{
+	eigen_assert(Base::m_analysisIsOk && "You must first call analyzePattern()");
+	const int n = (int)a.cols();
+	if (m_nThreads > 1 && !m_subtreesValid)
+		analyzeSubtrees();
+
+	// P * A * P^T, of which the upper part of column k is row k
+	typename Base::CholMatrixType ap(n, n);
+	if (Base::m_P.size() > 0)
+		ap.template selfadjointView<Eigen::Upper>() = a.template selfadjointView<Base::UpLo>().twistedBy(Base::m_P);
+	else
+		ap.template selfadjointView<Eigen::Upper>() = a.template selfadjointView<Base::UpLo>();
+	Base::m_diag.resize(n);
+
+	bool ok = true;
+	if (m_nThreads > 1)
+	{
+#pragma omp parallel num_threads(m_nThreads) reduction(&&: ok)
+		{
+			std::vector<Scalar> y(n, Scalar(0));
+			std::vector<int> pattern(n), tags(n, -1);
+#pragma omp for schedule(dynamic, 1)
+			for (int t = 0; t < (int)m_subtreeStart.size() - 1; t++)
+			{
+				for (int p = m_subtreeStart[t]; p < m_subtreeStart[t + 1] && ok; p++)
+					ok = factorizeRow(m_subtreeNodes[p], ap, y.data(), pattern.data(), tags.data());
+			}
+		}
+	}
+	std::vector<Scalar> y(n, Scalar(0));
+	std::vector<int> pattern(n), tags(n, -1);
+	for (int k = 0; k < n && ok; k++)
+	{
+		if (m_nThreads <= 1 || m_isTop[k])
+			ok = factorizeRow(k, ap, y.data(), pattern.data(), tags.data());
+	}
+	Base::m_info = ok ? Eigen::Success : Eigen::NumericalIssue;
+	Base::m_factorizationIsOk = true;
+
+	if (m_nThreads > 1 && !m_levelsValid && ok)
+		analyzeLevels();
+}
+
+template<class MatrixType>
+bool CholeskyFactor<MatrixType>::factorizeRow(int k, const typename Base::CholMatrixType& ap,
+	Scalar* y, int* pattern, int* tags)
+{
+	// the pattern of row k is its reach in the elimination tree from the entries of A(0:k, k), in topological order,
+	// y is zero and tags[i] < k for all i < k before
+	const int n = (int)ap.cols();
+	const StorageIndex* Lp = Base::m_matrix.outerIndexPtr();
+	StorageIndex* Li = Base::m_matrix.innerIndexPtr();
+	Scalar* Lx = Base::m_matrix.valuePtr();
+	Scalar* D = Base::m_diag.data();
+	StorageIndex* nnz = Base::m_nonZerosPerCol.data();
+	const StorageIndex* parent = Base::m_parent.data();
+	int top = n;
+	tags[k] = k;
+	nnz[k] = 0;
+	for (typename Base::CholMatrixType::InnerIterator it(ap, k); it; ++it)
+	{
+		int i = (int)it.index();
+		if (i > k)
+			continue;
+		y[i] += it.value();
+		int len = 0;
+		for (; tags[i] != k; i = parent[i])
+		{
+			pattern[len++] = i;
+			tags[i] = k;
+		}
+		while (len > 0)
+			pattern[--top] = pattern[--len];
+	}
+
+	// row k of L = (L_k^-1 * A(0:k, k))^T / D, appended to its columns
+	Scalar d = y[k] * Base::m_shiftScale + Base::m_shiftOffset;
+	y[k] = Scalar(0);
+	for (; top < n; top++)
+	{
+		const int i = pattern[top];
+		const Scalar yi = y[i];
+		y[i] = Scalar(0);
+		const Scalar l_ki = yi / D[i];
+		const StorageIndex q1 = Lp[i] + nnz[i];
+		StorageIndex q = Lp[i];
+		for (; q < q1; q++)
+			y[Li[q]] -= Lx[q] * yi;
+		d -= l_ki * yi;
+		Li[q] = k;
+		Lx[q] = l_ki;
+		nnz[i]++;
+	}
+	D[k] = d;
+	return d != Scalar(0);
+}
+
+template<class MatrixType>
+void CholeskyFactor<MatrixType>::analyzeLevels()
+{
+	const int n = (int)Base::m_matrix.cols();
+	const StorageIndex* Lp = Base::m_matrix.outerIndexPtr();
+	const StorageIndex* Li = Base::m_matrix.innerIndexPtr();
+	const StorageIndex* parent = Base::m_parent.data();
+	const int nThreads = m_nThreads;
+
+	// the transposed pattern, filled by ascending columns
+	m_rowStart.assign(n + 1, 0);
+	for (int j = 0; j < n; j++)
+		for (StorageIndex q = Lp[j]; q < Lp[j + 1]; q++)
+			m_rowStart[Li[q] + 1]++;
+	for (int i = 0; i < n; i++)
+		m_rowStart[i + 1] += m_rowStart[i];
+	m_rowCols.resize(m_rowStart[n]);
+	m_rowPos.resize(m_rowStart[n]);
+	std::vector<int> pos(m_rowStart.begin(), m_rowStart.end() - 1);
+	for (int j = 0; j < n; j++)
+	{
+		for (StorageIndex q = Lp[j]; q < Lp[j + 1]; q++)
+		{
+			m_rowCols[pos[Li[q]]] = j;
+			m_rowPos[pos[Li[q]]++] = (int)q;
+		}
+	}
+
+	// the heights, the subtrees below the top are those of factorize()
+	std::vector<int> height(n, 0);
+	for (int j = 0; j < n; j++)
+		if (parent[j] >= 0)
+			height[parent[j]] = std::max(height[parent[j]], height[j] + 1);
+
+	// the rows of the top: the leading columns of the subtrees, before the first column of the top
+	m_rowTopStart.assign(m_rowStart.begin() + 1, m_rowStart.end());
+	for (int i = 0; i < n; i++)
+	{
+		if (!m_isTop[i])
+			continue;
+		int q = m_rowStart[i];
+		while (q < m_rowStart[i + 1] && !m_isTop[m_rowCols[q]])
+			q++;
+		m_rowTopStart[i] = q;
+	}
+
+	// the top by height, the consecutive narrow heights merged into serial levels
+	std::vector<int> count(n + 1, 0);
+	for (int j = 0; j < n; j++)
+		if (m_isTop[j])
+			count[height[j]]++;
+	std::vector<int> level(n + 1, -1);
+	m_levelStart.assign(1, 0);
+	m_levelParallel.clear();
+	for (int h = 0; h < n; h++)
+	{
+		if (count[h] == 0)
+			continue;
+		const bool parallel = count[h] >= std::min(nThreads, (int)LEVEL_MIN_WIDTH);
+		if (parallel || m_levelParallel.empty() || m_levelParallel.back())
+		{
+			m_levelParallel.push_back(parallel);
+			m_levelStart.push_back(m_levelStart.back());
+		}
+		level[h] = (int)m_levelParallel.size() - 1;
+		m_levelStart.back() += count[h];
+	}
+	m_levelNodes.resize(m_levelStart.back());
+	pos.assign(m_levelStart.begin(), m_levelStart.end() - 1);
+	for (int j = 0; j < n; j++)
+		if (m_isTop[j])
+			m_levelNodes[pos[level[height[j]]]++] = j;
+	m_levelsValid = true;
+}
+
+template<class MatrixType>
+template<class Mat, class MatR>
+void CholeskyFactor<MatrixType>::solveLevels(const Mat& B, MatR& Y, Mat& X)const
+{
+	eigen_assert(Base::m_factorizationIsOk && m_levelsValid && "CholeskyFactor not factorized");
+	const int n = (int)Base::m_matrix.cols();
+	const int nCols = (int)B.cols();
+	const StorageIndex* Lp = Base::m_matrix.outerIndexPtr();
+	const StorageIndex* Li = Base::m_matrix.innerIndexPtr();
+	const Scalar* Lx = Base::m_matrix.valuePtr();
+	const Scalar* D = Base::m_diag.data();
+	const int nSubtrees = (int)m_subtreeStart.size() - 1;
+	const int nLevels = (int)m_levelParallel.size();
+	Y.resize(n, nCols);
+	X.resize(n, nCols);
+
+	// z_k = y_k - sum_j L_kj * z_j over the entries [q0, q1) of row k
+	auto forward = [&](int k, int q0, int q1)
+	{
+		Scalar* yk = Y.data() + (size_t)k * nCols;
+		for (int q = q0; q < q1; q++)
+		{
+			const Scalar* yj = Y.data() + (size_t)m_rowCols[q] * nCols;
+			const Scalar v = Lx[m_rowPos[q]];
+			for (int c = 0; c < nCols; c++)
+				yk[c] -= v * yj[c];
+		}
+	};
+	// x_k = z_k / D_k - sum_i L_ik * x_i over column k
+	auto backward = [&](int k)
+	{
+		Scalar* yk = Y.data() + (size_t)k * nCols;
+		for (int c = 0; c < nCols; c++)
+			yk[c] /= D[k];
+		for (StorageIndex q = Lp[k]; q < Lp[k + 1]; q++)
+		{
+			const Scalar* yi = Y.data() + (size_t)Li[q] * nCols;
+			const Scalar v = Lx[q];
+			for (int c = 0; c < nCols; c++)
+				yk[c] -= v * yi[c];
+		}
+	};
+
+#pragma omp parallel num_threads(m_nThreads)
+	{
+#pragma omp for
+		for (int i = 0; i < n; i++)
+			Y.row(permutedIndex(i)) = B.row(i);
+
+		// the subtrees from the leaves, the leading part of the top rows in them, then the top upwards
+#pragma omp for schedule(dynamic, 1)
+		for (int t = 0; t < nSubtrees; t++)
+		{
+			for (int p = m_subtreeStart[t]; p < m_subtreeStart[t + 1]; p++)
+			{
+				const int k = m_subtreeNodes[p];
+				forward(k, m_rowStart[k], m_rowStart[k + 1]);
+			}
+		}
+#pragma omp for schedule(dynamic, 16)
+		for (int p = 0; p < (int)m_levelNodes.size(); p++)
+		{
+			const int k = m_levelNodes[p];
+			forward(k, m_rowStart[k], m_rowTopStart[k]);
+		}
+		for (int l = 0; l < nLevels; l++)
+		{
+			if (m_levelParallel[l])
+			{
+#pragma omp for
+				for (int p = m_levelStart[l]; p < m_levelStart[l + 1]; p++)
+					forward(m_levelNodes[p], m_rowTopStart[m_levelNodes[p]], m_rowStart[m_levelNodes[p] + 1]);
+			}
+			else
+			{
+#pragma omp single
+				for (int p = m_levelStart[l]; p < m_levelStart[l + 1]; p++)
+					forward(m_levelNodes[p], m_rowTopStart[m_levelNodes[p]], m_rowStart[m_levelNodes[p] + 1]);
+			}
+		}
+
+		// the top downwards, then the subtrees
+		for (int l = nLevels - 1; l >= 0; l--)
+		{
+			if (m_levelParallel[l])
+			{
+#pragma omp for
+				for (int p = m_levelStart[l]; p < m_levelStart[l + 1]; p++)
+					backward(m_levelNodes[p]);
+			}
+			else
+			{
+#pragma omp single
+				for (int p = m_levelStart[l + 1] - 1; p >= m_levelStart[l]; p--)
+					backward(m_levelNodes[p]);
+			}
+		}
+#pragma omp for schedule(dynamic, 1)
+		for (int t = 0; t < nSubtrees; t++)
+			for (int p = m_subtreeStart[t + 1] - 1; p >= m_subtreeStart[t]; p--)
+				backward(m_subtreeNodes[p]);
+
+#pragma omp for
+		for (int i = 0; i < n; i++)
+			X.row(i) = Y.row(permutedIndex(i));
+	}
+}
+
+template<class MatrixType>
+Eigen::ComputationInfo CholeskyFactor<MatrixType>::rankUpdate(const Eigen::SparseVector<Scalar>& w, Scalar sigma)
+{
+	eigen_assert(Base::m_factorizationIsOk && "CholeskyFactor not factorized");
+	const int n = (int)Base::m_matrix.cols();
+	const StorageIndex* Lp = Base::m_matrix.outerIndexPtr();
+	const StorageIndex* Li = Base::m_matrix.innerIndexPtr();
+	Scalar* Lx = Base::m_matrix.valuePtr();
+	Scalar* D = Base::m_diag.data();
+	const StorageIndex* parent = Base::m_parent.data();
+	m_w.resize(n, Scalar(0));
+	m_mark.resize(n, 0);
+
+	// the union of the paths to the root, the updated w can be nonzero only there
+	m_path.clear();
+	for (typename Eigen::SparseVector<Scalar>::InnerIterator it(w); it; ++it)
+	{
+		int j = permutedIndex((int)it.index());
+		m_w[j] += it.value();
+		for (; j >= 0 && !m_mark[j]; j = parent[j])
+		{
+			m_mark[j] = 1;
+			m_path.push_back(j);
+		}
+	}
+	std::sort(m_path.begin(), m_path.end());
+
+	// Gill, Golub, Murray and Saunders, method C1, restricted to the path:
+	// the columns off the path have a zero w_j, for which a step changes nothing
+	Scalar alpha = sigma;
+	bool ok = true;
+	for (size_t k = 0; k < m_path.size(); k++)
+	{
+		const int j = m_path[k];
+		const Scalar p = m_w[j];
+		m_w[j] = Scalar(0);
+		m_mark[j] = 0;
+		if (p == Scalar(0) || !ok)
+			continue;
+		const Scalar d = D[j] + alpha * p * p;
+		if (!(d > Scalar(0)))
+		{
+			ok = false;
+			continue;
+		}
+		const Scalar beta = p * alpha / d;
+		alpha *= D[j] / d;
+		D[j] = d;
+		for (StorageIndex q = Lp[j]; q < Lp[j + 1]; q++)
+		{
+			Scalar& wi = m_w[Li[q]];
+			wi -= p * Lx[q];
+			Lx[q] += beta * wi;
+		}
+	}
+
+	Base::m_info = ok ? Eigen::Success : Eigen::NumericalIssue;
+	return Base::m_info;
+}
+
+template<class MatrixType>
+template<class MatR>
+void CholeskyFactor<MatrixType>::solveSparseRhs(const std::vector<int>& rows, const MatR& B, MatR& X, MatR& Y)const
+{
+	eigen_assert(Base::m_factorizationIsOk && "CholeskyFactor not factorized");
+	const int n = (int)Base::m_matrix.cols();
+	const StorageIndex* Lp = Base::m_matrix.outerIndexPtr();
+	const StorageIndex* Li = Base::m_matrix.innerIndexPtr();
+	const Scalar* Lx = Base::m_matrix.valuePtr();
+	const StorageIndex* parent = Base::m_parent.data();
+
+	// Y = P * B, and the reach in ascending order, which is a topological order of the elimination tree
+	std::vector<char> mark(n, 0);
+	std::vector<int> reach;
+	Y.setZero(n, B.cols());
+	for (size_t i = 0; i < rows.size(); i++)
+	{
+		int j = permutedIndex(rows[i]);
+		Y.row(j) = B.row(rows[i]);
+		for (; j >= 0 && !mark[j]; j = parent[j])
+		{
+			mark[j] = 1;
+			reach.push_back(j);
+		}
+	}
+	std::sort(reach.begin(), reach.end());
+
+	// L * Z = Y over the reach, then D
+	const int nCols = (int)B.cols();
+	for (size_t k = 0; k < reach.size(); k++)
+	{
+		const int j = reach[k];
+		const Scalar* yj = Y.data() + (size_t)j * nCols;
+		for (StorageIndex q = Lp[j]; q < Lp[j + 1]; q++)
+		{
+			Scalar* yi = Y.data() + (size_t)Li[q] * nCols;
+			for (int c = 0; c < nCols; c++)
+				yi[c] -= Lx[q] * yj[c];
+		}
+	}
+	for (size_t k = 0; k < reach.size(); k++)
+		Y.row(reach[k]) /= Base::m_diag[reach[k]];
+
+	// L^T * Y = Z, all the rows
+	for (int j = n - 1; j >= 0; j--)
+	{
+		Scalar* yj = Y.data() + (size_t)j * nCols;
+		for (StorageIndex q = Lp[j]; q < Lp[j + 1]; q++)
+		{
+			const Scalar* yi = Y.data() + (size_t)Li[q] * nCols;
+			for (int c = 0; c < nCols; c++)
+				yj[c] -= Lx[q] * yi[c];
+		}
+	}
+
+	X.resize(n, B.cols());
+	for (int i = 0; i < n; i++)
+		X.row(i) = Y.row(permutedIndex(i));
+}
+
+template<class MatrixType>
+Eigen::ComputationInfo CholeskyFactor<MatrixType>::refactorize(const MatrixType& a, const std::vector<int>& changed)
+{
+	eigen_assert(Base::m_factorizationIsOk && "CholeskyFactor not factorized");
+	const int n = (int)Base::m_matrix.cols();
+	const StorageIndex* Lp = Base::m_matrix.outerIndexPtr();
+	const StorageIndex* Li = Base::m_matrix.innerIndexPtr();
+	Scalar* Lx = Base::m_matrix.valuePtr();
+	Scalar* D = Base::m_diag.data();
+	const StorageIndex* parent = Base::m_parent.data();
+	m_w.resize(n, Scalar(0));
+	m_mark.resize(n, 0);
+
+	// the rows to compute again: the union of the paths to the root, ascending
+	m_path.clear();
+	for (size_t i = 0; i < changed.size(); i++)
+	{
+		for (int j = permutedIndex(changed[i]); j >= 0 && !m_mark[j]; j = parent[j])
+		{
+			m_mark[j] = 1;
+			m_path.push_back(j);
+		}
+	}
+	std::sort(m_path.begin(), m_path.end());
+
+	// P * A * P^T, of which the upper part of column k is row k
+	typename Base::CholMatrixType ap(n, n);
+	if (Base::m_P.size() > 0)
+		ap.template selfadjointView<Eigen::Upper>() = a.template selfadjointView<Base::UpLo>().twistedBy(Base::m_P);
+	else
+		ap.template selfadjointView<Eigen::Upper>() = a.template selfadjointView<Base::UpLo>();
+
+	// row k of L = (L_k^-1 * A(0:k, k))^T / D, over the pattern of row k, i.e. its reach in the elimination tree.
+	// The columns off the paths keep their values but still propagate y
+	std::vector<int> tags(n, -1), pattern(n);
+	bool ok = true;
+	for (size_t t = 0; t < m_path.size() && ok; t++)
+	{
+		const int k = m_path[t];
+		int top = n;
+		tags[k] = k;
+		for (typename Base::CholMatrixType::InnerIterator it(ap, k); it; ++it)
+		{
+			int i = (int)it.index();
+			if (i > k)
+				continue;
+			m_w[i] += it.value();
+			int len = 0;
+			for (; tags[i] != k; i = parent[i])
+			{
+				pattern[len++] = i;
+				tags[i] = k;
+			}
+			while (len > 0)
+				pattern[--top] = pattern[--len];
+		}
+
+		Scalar d = m_w[k] * Base::m_shiftScale + Base::m_shiftOffset;
+		m_w[k] = Scalar(0);
+		for (; top < n; top++)
+		{
+			const int i = pattern[top];
+			const Scalar yi = m_w[i];
+			m_w[i] = Scalar(0);
+			StorageIndex q = Lp[i];
+			for (; Li[q] < k; q++)
+				m_w[Li[q]] -= Lx[q] * yi;
+			const Scalar l_ki = yi / D[i];
+			d -= l_ki * yi;
+			if (m_mark[i])
+				Lx[q] = l_ki;
+		}
+		if (d == Scalar(0))
+			ok = false;
+		D[k] = d;
+	}
+
+	// clean the workspaces, also after a failure
+	for (size_t t = 0; t < m_path.size(); t++)
+		m_mark[m_path[t]] = 0;
+	std::fill(m_w.begin(), m_w.end(), Scalar(0));
+
+	Base::m_info = ok ? Eigen::Success : Eigen::NumericalIssue;
+	return Base::m_info;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+
+// Splits an elimination tree into independent subtrees for the threads of a factorization or a solve.
+// parent[j] > j for the n nodes, -1 at the roots, and work[j] is the work of the whole subtree of j.
+// The heaviest subtree is split at its root while there are too few subtrees for the threads to balance,
+// or one of them is too large a share of the work. The split roots are the top, isTop[j] = 1, which has to
+// follow all the subtrees; roots are the roots of the subtrees, the heaviest first.
+template<class Index>
+void splitSubtrees(const Index* parent, int n, const std::vector<double>& work, int nThreads,
+	std::vector<int>& roots, std::vector<char>& isTop)
+{
+	std::vector<int> childStart(n + 1, 0), children;
+	double total = 0;
+	for (int j = 0; j < n; j++)
+	{
+		if (parent[j] < 0)
+			total += work[j];
+		else
+			childStart[parent[j] + 1]++;
+	}
+	for (int j = 0; j < n; j++)
+		childStart[j + 1] += childStart[j];
+	children.resize(childStart[n]);
+	std::vector<int> pos(childStart.begin(), childStart.end() - 1);
+	for (int j = 0; j < n; j++)
+		if (parent[j] >= 0)
+			children[pos[parent[j]]++] = j;
+
+	auto lighter = [&](int a, int b) { return work[a] < work[b]; };
+	roots.clear();
+	for (int j = 0; j < n; j++)
+		if (parent[j] < 0)
+			roots.push_back(j);
+	std::make_heap(roots.begin(), roots.end(), lighter);
+	isTop.assign(n, 0);
+	while (!roots.empty() && ((int)roots.size() < 4 * nThreads || work[roots.front()] * 2 * nThreads > total))
+	{
+		const int r = roots.front();
+		if (childStart[r] == childStart[r + 1])
+			break;
+		std::pop_heap(roots.begin(), roots.end(), lighter);
+		roots.pop_back();
+		isTop[r] = 1;
+		for (int c = childStart[r]; c < childStart[r + 1]; c++)
+		{
+			roots.push_back(children[c]);
+			std::push_heap(roots.begin(), roots.end(), lighter);
+		}
+	}
+	std::sort_heap(roots.begin(), roots.end(), lighter);
+	std::reverse(roots.begin(), roots.end());
+}
@@ -1,451 +1,2028 @@
-#include "MeshTransfer.h"
-#include <fstream>
-#include "ParameterConfig.h"
-
-typedef MeshTransfer::real real;
-typedef MeshTransfer::Float3 Float3;
-typedef MeshTransfer::Int3 Int3;
-typedef MeshTransfer::Int4 Int4;
-typedef MeshTransfer::Mat3f Mat3f;
-
-template <class T>
-static bool hasIllegalData(const T* data, int n)
-{
-	for (int i = 0; i < n; i++)
-	{
-		if (std::isinf(data[i]) || std::isnan(data[i]))
-			return true;
-	}
-	return false;
-}
-
-bool hasIllegalTriangle(const Int3* pTris, int n)
-{
-	for (int i = 0; i < n; i++)
-	{
-		const Int3& t = pTris[i];
-		if (t[0] < 0 || t[1] < 0 || t[2] < 0)
-			return true;
-		if (t[0] == t[1] || t[0] == t[2] || t[1] == t[2])
-			return true;
-	}
-	return false;
-}
-
-const char* MeshTransfer::getErrString()const
-{
-	return m_errStr.c_str();
-}
-
-bool MeshTransfer::init(int nTriangles, const Int3* pTriangles, int nVertices, 
-	const Float3* pSrcVertices0, const Float3* pTarVertices0)
-{
-	clear();
-	if (hasIllegalData((const float*)pSrcVertices0, nVertices * 3))
-	{
-		m_errStr = "nan or inf in input pSrcVertices0";
-		return false;
-	}
-	if (hasIllegalData((const float*)pTarVertices0, nVertices * 3))
-	{
-		m_errStr = "nan or inf in input pTarVertices0";
-		return false;
-	}
-	if (hasIllegalTriangle(pTriangles, nTriangles))
-	{
-		m_errStr = "illegal or trivial triangles in pTriangles!";
-		return false;
-	}
-
-	m_srcVerts0.resize(nVertices);
-	memcpy(m_srcVerts0.data(), pSrcVertices0, nVertices * sizeof(Float3));
-
-	m_tarVerts0.resize(nVertices);
-	memcpy(m_tarVerts0.data(), pTarVertices0, nVertices * sizeof(Float3));
-
-	m_facesTri.resize(nTriangles);
-	for (int i = 0; i < nTriangles; i++)
-		m_facesTri[i] = pTriangles[i];
-
-	// precomputation
-	findAnchorPoints();
-	setup_ancorMat();
-	setup_RegularizationMat();
-	setup_E1Mat(m_tarVerts0);
-	setup_RegularizationRhs(m_tarVerts0);
-	setup_ancorRhs(m_tarVerts0);
-
-	if (hasIllegalData(m_E1Mat.valuePtr(), (int)m_E1Mat.nonZeros()))
-	{
-		m_errStr = "nan or inf in E1Mat!";
-		return false;
-	}
-
-	const real w_anchor = real(MeshTransferParameter::Transfer_Weight_Anchor / (1e-3f + m_ancorMat.rows()));
-	const real w_reg = real(MeshTransferParameter::Transfer_Weight_Regularization / (1e-3f + m_regAtA.rows()));
-	const real w1 = real(MeshTransferParameter::Transfer_Weight_Correspond / (1e-3f + m_E1Mat.rows()));
-	
-	m_ancorMatT = m_ancorMat.transpose();
-	m_E1MatT = m_E1Mat.transpose();
-	m_E1MatT *= w1;
-	
-	m_AtA = m_E1MatT * m_E1Mat + m_ancorMatT * m_ancorMat * w_anchor + m_regAtA * w_reg;
-	m_anchorRegSumAtb = m_ancorMatT * m_ancorRhs * w_anchor + m_regAtb * w_reg;
-	m_solver.compute(m_AtA);
-
-	m_bInit = true;
-	m_shouldAnalysisTopology = true;
-	return true;
-}
-
-template<class T>
-static void FastTransGivenStructure(const Eigen::SparseMatrix<T>& A, Eigen::SparseMatrix<T>& At)
-{
-	Eigen::VectorXi positions(At.outerSize());
-	for (int i = 0; i<At.outerSize(); i++)
-		positions[i] = At.outerIndexPtr()[i];
-	for (int j = 0; j<A.outerSize(); ++j)
-	{
-		for (typename Eigen::SparseMatrix<T>::InnerIterator it(A, j); it; ++it)
-		{
-			int i = it.index();
-			int pos = positions[i]++;
-			At.valuePtr()[pos] = it.value();
-		}
-	}
-}
-
-template<class T>
-void FastAtAGivenStructure(const Eigen::SparseMatrix<T>& A, const Eigen::SparseMatrix<T>& At, Eigen::SparseMatrix<T>& AtA)
-{
-	MeshTransfer::Vec Tmp;
-	Eigen::VectorXi Mark;
-	Tmp.resize(AtA.innerSize());
-	Mark.resize(AtA.innerSize());
-	Mark.setZero();
-
-	for (int j = 0; j<AtA.outerSize(); j++)
-	{
-		for ( typename Eigen::SparseMatrix<T>::InnerIterator it_A(A, j); it_A; ++it_A)
-		{
-			int k = it_A.index();
-			real v_A = it_A.value();
-
-			for ( typename Eigen::SparseMatrix<T>::InnerIterator it_At(At, k); it_At; ++it_At)
-			{
-				int i = it_At.index();
-				real v_At = it_At.value();
-				if (!Mark[i])
-				{
-					Mark[i] = 1;
-					Tmp[i] = v_A*v_At;
-				}
-				else
-					Tmp[i] += v_A*v_At;
-			}//end for it_At
-		}//end for it_A
-
-		for ( typename Eigen::SparseMatrix<T>::InnerIterator it(AtA, j); it; ++it)
-		{
-			int i = it.index();
-			it.valueRef() = Tmp[i];
-			Mark[i] = 0;
-		}
-	}//end for i
-}
-
-bool MeshTransfer::transfer(const std::vector<Float3>& srcVertsDeformed, std::vector<Float3>& tarVertsDeformed)
-{
-	if (!m_bInit)
-	{
-		m_errStr = "not initialized when calling transfer()";
-		return false;
-	}
-	if (srcVertsDeformed.size() != m_srcVerts0.size())
-	{
-		m_errStr = "transfer: vertex size not matched!";
-		return false;
-	}
-	if (hasIllegalData((const float*)srcVertsDeformed.data(), (int)srcVertsDeformed.size() * 3))
-	{
-		m_errStr = "nan or inf in srcVertsDeformed!";
-		return false;
-	}
-
-	// computing all energy matrices
-	setup_E1Rhs(srcVertsDeformed);
-	
-	// sum all the energy terms
-	m_Atb = m_E1MatT * m_E1Rhs;
-	m_Atb += m_anchorRegSumAtb;
-	
-	// solve
-	m_x = m_solver.solve(m_Atb);
-
-	// return the value
-	vertex_vec_to_point(m_x, tarVertsDeformed);
-
-	if (hasIllegalData((const float*)tarVertsDeformed.data(), (int)tarVertsDeformed.size() * 3))
-	{
-		m_errStr = "finished transfer, but nan or inf in tarVertsDeformed!";
-		return false;
-	}
-	return true;
-}
-
-void MeshTransfer::clear()
-{
-	m_bInit = false;
-	m_shouldAnalysisTopology = false;
-	m_facesTri.clear();
-	m_anchors.clear();
-	m_srcVerts0.clear();
-}
-
-void MeshTransfer::findAnchorPoints()
-{
-	// ldp: may be we should manually specify anchor points
-	//		to make the results' global position reasonable
-	m_anchors.clear();
-	m_anchors.push_back(0);
-}
-
-void MeshTransfer::vertex_vec_to_point(const Vec& x, std::vector<Float3>& verts)const
-{
-	verts.resize(m_srcVerts0.size());
-	for (int i = 0; i < verts.size(); i++)
-		for (int k = 0; k < 3; k++)
-			verts[i][k] = (float)x[k*(x.size() / 3) + i];
-}
-
-void MeshTransfer::vertex_point_to_vec(Vec& x, const std::vector<Float3>& verts, const std::vector<Int3>& faces)const
-{
-	int nTotalVerts = (int)verts.size() + (int)faces.size();
-	if (x.size() != nTotalVerts)
-		x.resize(nTotalVerts * 3);
-
-	x.setZero();
-	for (int i = 0; i < verts.size(); i++)
-		for (int k = 0; k < 3; k++)
-			x[k*nTotalVerts + i] = verts[i][k];
-
-	for (int i = 0; i < faces.size(); i++)
-	{
-		int row = (int)verts.size() + i;
-		const Int3& f = faces[i];
-		Float3 v = verts[f[0]] + (verts[f[1]] - verts[f[0]]).cross(verts[f[2]] - verts[f[0]]).normalized();
-		for (int k = 0; k < 3; k++)
-			x[k*nTotalVerts + row] = v[k];
-	}
-}
-
-inline void fill4VertsOfFace(int id_f, const std::vector<Int3>& faces, const std::vector<Float3>& verts, int *id_v, Float3* v)
-{
-	Int3 f = faces[id_f];
-	int k = 0;
-	for (int k = 0; k < 3; k++)
-	{
-		id_v[k] = f[k];
-		v[k] = verts[id_v[k]];
-	}
-	v[3] = v[0] + (v[1] - v[0]).cross(v[2] - v[0]).normalized();
-	id_v[3] = (int)verts.size() + id_f;
-}
-
-inline Mat3f getV(Float3* v)
-{
-	Mat3f V;
-	for (int y = 0; y < 3; y++)
-		for (int x = 0; x < 3; x++)
-			V(y, x) = v[x + 1][y] - v[0][y];
-	return V;
-}
-
-inline void getMatrix_namedby_T(Float3* v, Eigen::Matrix<real, 3, 4>& A)
-{
-	Mat3f V = getV(v).inverse();
-
-	// The matrix T is in block diag style:
-	// | A 0 0 |
-	// | 0 A 0 |
-	// | 0 0 A |
-	// where each A is a 3x4 matrix
-	A(0, 0) = -V(0, 0) - V(1, 0) - V(2, 0);
-	A(0, 1) = V(0, 0);
-	A(0, 2) = V(1, 0);
-	A(0, 3) = V(2, 0);
-	A(1, 0) = -V(0, 1) - V(1, 1) - V(2, 1);
-	A(1, 1) = V(0, 1);
-	A(1, 2) = V(1, 1);
-	A(1, 3) = V(2, 1);
-	A(2, 0) = -V(0, 2) - V(1, 2) - V(2, 2);
-	A(2, 1) = V(0, 2);
-	A(2, 2) = V(1, 2);
-	A(2, 3) = V(2, 2);
-}
-
-inline void fillCooSys_by_Mat(std::vector<Eigen::Triplet<real>>& cooSys, int row,
-	int nTotalVerts, int* id, const Eigen::Matrix<real, 3, 4>& T)
-{
-	// The matrix T is in block diag style:
-	// | A 0 0 |
-	// | 0 A 0 |
-	// | 0 0 A |
-	// where each A is a 3x4 matrix
-	const static int nBlocks = 3;
-	const static int nPoints = 4;
-	const static int nCoords = 3;
-	int pos = row * 4;
-	for (int iBlock = 0; iBlock < nBlocks; iBlock++)
-	{
-		const int yb = iBlock * nCoords;
-		for (int y = 0; y < nCoords; y++)
-		{
-			for (int x = 0; x < nPoints; x++)
-			{
-				const int col = nTotalVerts * iBlock + id[x];
-				cooSys[pos++] = Eigen::Triplet<real>(row + yb + y, col, T(y, x));
-			}
-		}
-	} // end for iBlock
-}
-
-void MeshTransfer::setup_E1Mat(const std::vector<Float3>& tarVerts0)
-{
-	const int nMeshVerts = (int)tarVerts0.size();
-	const int nTotalVerts = nMeshVerts + (int)m_facesTri.size();
-	std::vector<Eigen::Triplet<real>> cooSys;
-
-	m_E1Rhs.resize(m_facesTri.size() * 9);
-	cooSys.resize(m_E1Rhs.size() * 4);
-
-	Eigen::Matrix<real, 3, 4> Ti;
-	Ti.setZero();
-	Int4 id_vi_tar;
-	Float3 vi_tar[4];
-	for (int iFace = 0; iFace < (int)m_facesTri.size(); iFace++)
-	{
-		// face_i_tar
-		fill4VertsOfFace(iFace, m_facesTri, tarVerts0, id_vi_tar.data(), vi_tar);
-		getMatrix_namedby_T(vi_tar, Ti);
-
-		// construct the gradient transfer matrix
-		bool inValid = hasIllegalData(Ti.data(), (int)Ti.size());
-		if (inValid)
-			Ti.setZero();
-
-		// push matrix
-		const int row = iFace * 9;
-		fillCooSys_by_Mat(cooSys, row, nTotalVerts, id_vi_tar.data(), Ti);
-	}
-
-	m_E1Mat.resize((int)m_E1Rhs.size(), nTotalVerts * 3);
-	if (cooSys.size() > 0)
-		m_E1Mat.setFromTriplets(cooSys.begin(), cooSys.end());
-}
-
-void MeshTransfer::setup_E1Rhs(const std::vector<Float3>& srcVertsDeformed)
-{
-	const int nMeshVerts = (int)srcVertsDeformed.size();
-	m_E1Rhs.resize(m_facesTri.size() * 9);
-	Eigen::Matrix<real, 3, 4> Si_A;
-	Eigen::Matrix<real, 4, 1> Si_x[3];
-	Eigen::Matrix<real, 3, 1> Si_b[3];
-	Si_A.setZero();
-	Int4 id_vi_src0, id_vi_src1;
-	Float3 vi_src0[4], vi_src1[4];
-	for (int iFace = 0; iFace < (int)m_facesTri.size(); iFace++)
-	{
-		// face_i_src
-		fill4VertsOfFace(iFace, m_facesTri, m_srcVerts0, id_vi_src0.data(), vi_src0);
-		fill4VertsOfFace(iFace, m_facesTri, srcVertsDeformed, id_vi_src1.data(), vi_src1);
-
-		// construct the gradient transfer matrix
-		getMatrix_namedby_T(vi_src0, Si_A);
-		bool inValid = hasIllegalData(Si_A.data(), (int)Si_A.size());
-		for (int k = 0; k < 4; k++)
-		{
-			Si_x[0][k] = vi_src1[k][0];
-			Si_x[1][k] = vi_src1[k][1];
-			Si_x[2][k] = vi_src1[k][2];
-		}
-		if (inValid)
-		{
-			Si_A.setZero();
-			Si_x[0].setZero();
-			Si_x[1].setZero();
-			Si_x[2].setZero();
-		}
-		Si_b[0] = Si_A * Si_x[0];
-		Si_b[1] = Si_A * Si_x[1];
-		Si_b[2] = Si_A * Si_x[2];
-
-		// push matrix
-		const int row = iFace * 9;
-		m_E1Rhs[row + 0] = Si_b[0][0];
-		m_E1Rhs[row + 1] = Si_b[0][1];
-		m_E1Rhs[row + 2] = Si_b[0][2];
-
-		m_E1Rhs[row + 3] = Si_b[1][0];
-		m_E1Rhs[row + 4] = Si_b[1][1];
-		m_E1Rhs[row + 5] = Si_b[1][2];
-
-		m_E1Rhs[row + 6] = Si_b[2][0];
-		m_E1Rhs[row + 7] = Si_b[2][1];
-		m_E1Rhs[row + 8] = Si_b[2][2];
-	}
-}
-
-void MeshTransfer::setup_ancorMat()
-{
-	const int nMeshVerts = (int)m_srcVerts0.size();
-	const int nTotalVerts = nMeshVerts + (int)m_facesTri.size();
-	m_ancorMat.resize((int)m_anchors.size() * 3, nTotalVerts * 3);
-
-	// build matrix
-	for (int i = 0; i < m_anchors.size(); i++)
-	{
-		for (int k = 0; k<3; k++)
-			m_ancorMat.insert(i * 3 + k, m_anchors[i] + nTotalVerts*k) = 1;
-	}
-	m_ancorMat.finalize();
-}
-
-void MeshTransfer::setup_ancorRhs(const std::vector<Float3>& tarVerts0)
-{
-	const int nMeshVerts = (int)tarVerts0.size();
-	const int nTotalVerts = nMeshVerts + (int)m_facesTri.size();
-	m_ancorRhs.resize((int)m_anchors.size() * 3);
-	m_ancorRhs.setZero();
-
-	// build matrix
-	for (int i = 0; i < m_anchors.size(); i++)
-	{
-		for (int k = 0; k<3; k++)
-			m_ancorRhs[i * 3 + k] = tarVerts0[m_anchors[i]][k];
-	}
-}
-
-void MeshTransfer::setup_RegularizationMat()
-{
-	const int nMeshVerts = (int)m_srcVerts0.size();
-	const int nTotalVerts = nMeshVerts + (int)m_facesTri.size();
-	m_regAtA.resize(nTotalVerts * 3, nTotalVerts * 3);
-	m_regAtA.reserve(nTotalVerts * 3);
-	for (int row = 0; row < m_regAtA.rows(); row++)
-		m_regAtA.insert(row, row) = 1;
-	m_regAtA.finalize();
-}
-
-void MeshTransfer::setup_RegularizationRhs(const std::vector<Float3>& tarVerts0)
-{
-	const int nMeshVerts = (int)m_srcVerts0.size();
-	const int nTotalVerts = nMeshVerts + (int)m_facesTri.size();
-	m_regAtb.resize(nTotalVerts * 3);
-	m_regAtb.setZero();
-	for (int iVert = 0; iVert < nMeshVerts; iVert++)
-	{
-		for (int k = 0; k < 3; k++)
-			m_regAtb[iVert + k * nTotalVerts] = tarVerts0[iVert][k];
-	}
-}
+#include "MeshTransfer.h"
+#include <fstream>
+#include <algorithm>
+#include <limits>
+#include "ParameterConfig.h"
+#include <omp.h>
+
+typedef MeshTransfer::real real;
+typedef MeshTransfer::Float3 Float3;
+typedef MeshTransfer::Int3 Int3;
+typedef MeshTransfer::Int4 Int4;
+typedef MeshTransfer::Mat3f Mat3f;
+
+template <class T>
+static bool hasIllegalData(const T* data, int n)
+{
+	for (int i = 0; i < n; i++)
+	{
+		if (std::isinf(data[i]) || std::isnan(data[i]))
+			return true;
+	}
+	return false;
+}
+
+bool hasIllegalTriangle(const Int3* pTris, int n)
+{
+	for (int i = 0; i < n; i++)
+	{
+		const Int3& t = pTris[i];
+		if (t[0] < 0 || t[1] < 0 || t[2] < 0)
+			return true;
+		if (t[0] == t[1] || t[0] == t[2] || t[1] == t[2])
+			return true;
+	}
+	return false;
+}
+
+const char* MeshTransfer::getErrString()const
+{
+	return m_errStr.c_str();
+}
+
+MeshTransfer::Weights::Weights()
+{
+	correspond = real(MeshTransferParameter::Transfer_Weight_Correspond);
+	anchor = real(MeshTransferParameter::Transfer_Weight_Anchor);
+	landmark = real(MeshTransferParameter::Transfer_Weight_Landmark);
+	regularization = real(MeshTransferParameter::Transfer_Weight_Regularization);
+	emphasisKappa = real(MeshTransferParameter::Transfer_Graident_Emhasis_kappa);
+	emphasisTheta = real(MeshTransferParameter::Transfer_Graident_Emhasis_theta);
+}
+
+static bool isLegalWeights(const MeshTransfer::Weights& w)
+{
+	const real v[6] = { w.correspond, w.anchor, w.landmark, w.regularization, w.emphasisKappa, w.emphasisTheta };
+	if (hasIllegalData(v, 6))
+		return false;
+	return w.correspond >= 0 && w.anchor >= 0 && w.landmark >= 0 && w.regularization > 0 && w.emphasisKappa > 0;
+}
+
+bool MeshTransfer::init(int nTriangles, const Int3* pTriangles, int nVertices, 
+	const Float3* pSrcVertices0, const Float3* pTarVertices0, const Weights& weights)
+{
+	clear();
+	if (!isLegalWeights(weights))
+	{
+		m_errStr = "illegal weights!";
+		return false;
+	}
+	if (hasIllegalData((const float*)pSrcVertices0, nVertices * 3))
+	{
+		m_errStr = "nan or inf in input pSrcVertices0";
+		return false;
+	}
+	if (hasIllegalData((const float*)pTarVertices0, nVertices * 3))
+	{
+		m_errStr = "nan or inf in input pTarVertices0";
+		return false;
+	}
+	if (hasIllegalTriangle(pTriangles, nTriangles))
+	{
+		m_errStr = "illegal or trivial triangles in pTriangles!";
+		return false;
+	}
+	if (m_gradientEmphasis && m_solverType != SolverCholesky)
+	{
+		m_errStr = "the gradient emphasis is only supported by SolverCholesky!";
+		return false;
+	}
+	for (size_t i = 0; i < m_landmarks.size(); i++)
+	{
+		if (hasIllegalData(m_landmarks[i].weights.data(), 4))
+		{
+			m_errStr = "nan or inf in landmark weights!";
+			return false;
+		}
+		for (int k = 0; k < 4; k++)
+		{
+			if (m_landmarks[i].weights[k] != 0 && (m_landmarks[i].verts[k] < 0 || m_landmarks[i].verts[k] >= nVertices))
+			{
+				m_errStr = "landmark vertex index out of range!";
+				return false;
+			}
+		}
+	}
+
+	m_srcVerts0.resize(nVertices);
+	memcpy(m_srcVerts0.data(), pSrcVertices0, nVertices * sizeof(Float3));
+
+	m_tarVerts0.resize(nVertices);
+	memcpy(m_tarVerts0.data(), pTarVertices0, nVertices * sizeof(Float3));
+
+	m_facesTri.resize(nTriangles);
+	for (int i = 0; i < nTriangles; i++)
+		m_facesTri[i] = pTriangles[i];
+
+	// precomputation
+	findAnchorPoints();
+	setup_ancorMat();
+	setup_landmarkMat();
+	setup_srcOperators(m_srcVerts0);
+
+	m_weights = weights;
+	m_w = normalizeWeights(m_weights);
+
+	if (!setup_target())
+		return false;
+
+	m_bInit = true;
+	return true;
+}
+
+bool MeshTransfer::setTarget(const std::vector<Float3>& tarVerts0)
+{
+	if (!m_bInit)
+	{
+		m_errStr = "not initialized when calling setTarget()";
+		return false;
+	}
+	if (tarVerts0.size() != m_tarVerts0.size())
+	{
+		m_errStr = "setTarget: vertex size not matched!";
+		return false;
+	}
+	if (hasIllegalData((const float*)tarVerts0.data(), (int)tarVerts0.size() * 3))
+	{
+		m_errStr = "nan or inf in input tarVerts0";
+		return false;
+	}
+
+	m_tarVerts0 = tarVerts0;
+	modelChanged();
+	if (!setup_target())
+	{
+		m_bInit = false;
+		return false;
+	}
+	return true;
+}
+
+bool MeshTransfer::setWeights(const Weights& weights)
+{
+	if (!m_bInit)
+	{
+		m_errStr = "not initialized when calling setWeights()";
+		return false;
+	}
+	if (!isLegalWeights(weights))
+	{
+		m_errStr = "illegal weights!";
+		return false;
+	}
+
+	m_weights = weights;
+	m_w = normalizeWeights(m_weights);
+	modelChanged();
+	if (!setup_target())
+	{
+		m_bInit = false;
+		return false;
+	}
+	return true;
+}
+
+bool MeshTransfer::sweepWeights(const std::vector<Weights>& settings, const std::vector<std::vector<Float3>>& srcVerts1,
+	std::vector<std::vector<std::vector<Float3>>>& tarVerts1, int nThreads)
+{
+	if (!m_bInit)
+	{
+		m_errStr = "not initialized when calling sweepWeights()";
+		return false;
+	}
+	if (m_solverType != SolverCholesky)
+	{
+		m_errStr = "sweepWeights() is only supported by SolverCholesky!";
+		return false;
+	}
+	for (size_t i = 0; i < settings.size(); i++)
+	{
+		if (!isLegalWeights(settings[i]))
+		{
+			m_errStr = "illegal weights in sweepWeights()!";
+			return false;
+		}
+	}
+
+	// the threads run whole settings, the per-face loops inside them are not nested in parallel
+	const int nSettings = (int)settings.size();
+	tarVerts1.resize(nSettings);
+	bool ok = true;
+#pragma omp parallel num_threads(nThreads > 0 ? nThreads : omp_get_max_threads())
+	{
+		Workspace ws;
+		ws.ownWeights = true;
+#pragma omp for schedule(dynamic)
+		for (int i = 0; i < nSettings; i++)
+		{
+			ws.weights = normalizeWeights(settings[i]);
+			setup_constantAtb(ws.weights, ws.constantAtb);
+			if ((!m_gradientEmphasis && !factorize_workspace(ws)) || !transferBatch(srcVerts1, tarVerts1[i], ws))
+			{
+#pragma omp critical
+				{
+					ok = false;
+					m_errStr = ws.errStr;
+				}
+			}
+		}
+	}
+	return ok;
+}
+
+bool MeshTransfer::setLandmarkTargets(const std::vector<Float3>& targets)
+{
+	if (!m_bInit)
+	{
+		m_errStr = "not initialized when calling setLandmarkTargets()";
+		return false;
+	}
+	if (targets.size() != m_landmarks.size())
+	{
+		m_errStr = "setLandmarkTargets: landmark size not matched!";
+		return false;
+	}
+	if (hasIllegalData((const float*)targets.data(), (int)targets.size() * 3))
+	{
+		m_errStr = "nan or inf in input landmark targets";
+		return false;
+	}
+
+	// the landmark rows are already in AtA, only C^T * rhs changes
+	clear_blendshapeBasis();
+	modelChanged();
+	for (size_t i = 0; i < targets.size(); i++)
+	{
+		for (int k = 0; k < 3; k++)
+			m_landmarkRhs(i, k) = targets[i][k];
+	}
+	setup_constantAtb(m_w, m_anchorRegSumAtb);
+	return true;
+}
+
+bool MeshTransfer::addAnchors(const std::vector<int>& vertIds)
+{
+	return update_anchors(vertIds, true);
+}
+
+bool MeshTransfer::removeAnchors(const std::vector<int>& vertIds)
+{
+	return update_anchors(vertIds, false);
+}
+
+bool MeshTransfer::update_anchors(const std::vector<int>& vertIds, bool add)
+{
+	if (!m_bInit)
+	{
+		m_errStr = "not initialized when calling addAnchors()/removeAnchors()";
+		return false;
+	}
+	const int nMeshVerts = (int)m_srcVerts0.size();
+	for (size_t i = 0; i < vertIds.size(); i++)
+	{
+		if (vertIds[i] < 0 || vertIds[i] >= nMeshVerts)
+		{
+			m_errStr = "anchor index out of range!";
+			return false;
+		}
+	}
+
+	// the vertices really added or removed, the others are ignored
+	std::vector<int> changed;
+	for (size_t i = 0; i < vertIds.size(); i++)
+	{
+		std::vector<int>::iterator it = std::find(m_anchors.begin(), m_anchors.end(), vertIds[i]);
+		if (add && it == m_anchors.end())
+			m_anchors.push_back(vertIds[i]);
+		else if (!add && it != m_anchors.end())
+			m_anchors.erase(it);
+		else
+			continue;
+		changed.push_back(vertIds[i]);
+	}
+	if (changed.empty())
+		return true;
+	clear_blendshapeBasis();
+	modelChanged();
+
+	// the anchor weight is normalized by the number of anchors as in init(), thus all the anchors change
+	setup_ancorMat();
+	m_w = normalizeWeights(m_weights);
+	setup_ancorRhs(m_tarVerts0);
+	setup_constantAtb(m_w, m_anchorRegSumAtb);
+
+	if (m_solverType == SolverMatrixFreePCG)
+	{
+		setup_pcgPreconditioner();
+		return true;
+	}
+
+	// AtA is rebuilt rather than patched, subtracting the large anchor terms would cancel the small ones.
+	// Only the diagonal entries of the old and new anchors changed, thus with the double factor only the rows
+	// on their elimination-tree paths are factored again; the float factor is of S * AtA * S, where S changed
+	setup_AtA();
+	if (m_solverType == SolverCholesky && (m_precision == PrecisionDouble || m_gradientEmphasis))
+	{
+		std::vector<int> unknowns = m_anchors;
+		if (!add)
+			unknowns.insert(unknowns.end(), changed.begin(), changed.end());
+		if (m_solver.refactorize(m_AtA, unknowns) == Eigen::Success)
+			return true;
+	}
+	if (!factorize())
+	{
+		m_bInit = false;
+		return false;
+	}
+	return true;
+}
+
+bool MeshTransfer::setBlendshapeBasis(const std::vector<std::vector<Float3>>& srcShapes)
+{
+	if (!m_bInit)
+	{
+		m_errStr = "not initialized when calling setBlendshapeBasis()";
+		return false;
+	}
+	if (srcShapes.empty())
+	{
+		m_errStr = "setBlendshapeBasis: no shapes!";
+		return false;
+	}
+
+	// A0 is transferred together with the shapes, so that w = 0 and w = e_k reproduce transfer() exactly
+	const int nShapes = (int)srcShapes.size();
+	const int nRows = (int)m_srcVerts0.size() * 3;
+	std::vector<std::vector<Float3>> srcVerts1(nShapes + 1), tarVerts1;
+	srcVerts1[0] = m_srcVerts0;
+	std::copy(srcShapes.begin(), srcShapes.end(), srcVerts1.begin() + 1);
+	clear_blendshapeBasis();
+	if (!transferBatch(srcVerts1, tarVerts1))
+		return false;
+
+	m_basisRest = Eigen::Map<const Eigen::VectorXf>((const float*)tarVerts1[0].data(), nRows);
+	m_basisDelta.resize(nRows, nShapes);
+	m_basisSrcDelta.resize(nRows, nShapes);
+	const Eigen::Map<const Eigen::VectorXf> src0((const float*)m_srcVerts0.data(), nRows);
+	for (int k = 0; k < nShapes; k++)
+	{
+		m_basisDelta.col(k) = Eigen::Map<const Eigen::VectorXf>((const float*)tarVerts1[k + 1].data(), nRows) - m_basisRest;
+		m_basisSrcDelta.col(k) = Eigen::Map<const Eigen::VectorXf>((const float*)srcShapes[k].data(), nRows) - src0;
+	}
+	return true;
+}
+
+bool MeshTransfer::evalBlendshapes(const std::vector<float>& weights, std::vector<Float3>& tarVerts, bool corrective)
+{
+	if (!evalBlendshapes(weights, tarVerts, corrective, m_workspace))
+	{
+		m_errStr = m_workspace.errStr;
+		return false;
+	}
+	return true;
+}
+
+bool MeshTransfer::evalBlendshapes(const std::vector<float>& weights, std::vector<Float3>& tarVerts, bool corrective,
+	Workspace& ws)const
+{
+	if (m_basisDelta.cols() == 0)
+	{
+		ws.errStr = "no blendshape basis when calling evalBlendshapes()";
+		return false;
+	}
+	if ((int)weights.size() != m_basisDelta.cols())
+	{
+		ws.errStr = "evalBlendshapes: weight size not matched!";
+		return false;
+	}
+	if (hasIllegalData(weights.data(), (int)weights.size()))
+	{
+		ws.errStr = "nan or inf in blendshape weights";
+		return false;
+	}
+
+	const Eigen::Map<const Eigen::VectorXf> w(weights.data(), weights.size());
+	if (corrective)
+	{
+		std::vector<Float3> srcVerts(m_srcVerts0.size());
+		Eigen::Map<Eigen::VectorXf> src((float*)srcVerts.data(), m_basisSrcDelta.rows());
+		src = Eigen::Map<const Eigen::VectorXf>((const float*)m_srcVerts0.data(), m_basisSrcDelta.rows());
+		src.noalias() += m_basisSrcDelta * w;
+		return transfer(srcVerts, tarVerts, ws);
+	}
+
+	tarVerts.resize(m_srcVerts0.size());
+	Eigen::Map<Eigen::VectorXf> tar((float*)tarVerts.data(), m_basisDelta.rows());
+	tar = m_basisRest;
+	tar.noalias() += m_basisDelta * w;
+	return true;
+}
+
+void MeshTransfer::clear_blendshapeBasis()
+{
+	m_basisRest.resize(0);
+	m_basisDelta.resize(0, 0);
+	m_basisSrcDelta.resize(0, 0);
+}
+
+void MeshTransfer::modelChanged()
+{
+	// workspaces compare the version before reusing their previous frames
+	m_modelVersion++;
+	resetWarmStart();
+}
+
+void MeshTransfer::checkModelVersion(Workspace& ws)const
+{
+	// the previous frames of a workspace are stale once the model changed
+	if (ws.modelVersion == m_modelVersion)
+		return;
+	ws.nHistory = 0;
+	ws.hasIncremental = false;
+	ws.modelVersion = m_modelVersion;
+}
+
+bool MeshTransfer::setup_target()
+{
+	clear_blendshapeBasis();
+	// all the terms depending on B0, the pattern of E1 only depends on the topology
+	setup_E1Mat(m_tarVerts0);
+	setup_RegularizationRhs(m_tarVerts0);
+	setup_ancorRhs(m_tarVerts0);
+	setup_landmarkRhs(m_tarVerts0);
+
+	if (hasIllegalData(m_E1Mat.valuePtr(), (int)m_E1Mat.nonZeros()))
+	{
+		m_errStr = "nan or inf in E1Mat!";
+		return false;
+	}
+
+	setup_constantAtb(m_w, m_anchorRegSumAtb);
+
+	// matrix free: only the face coloring for the parallel scatters and the preconditioner
+	if (m_solverType == SolverMatrixFreePCG)
+	{
+		if (m_shouldAnalysisTopology)
+			setup_faceColoring();
+		setup_pcgPreconditioner();
+		m_shouldAnalysisTopology = false;
+		return true;
+	}
+
+	if (m_shouldAnalysisTopology)
+		setup_AtAPattern();
+	setup_AtA();
+	return factorize();
+}
+
+bool MeshTransfer::factorize_workspace(Workspace& ws)const
+{
+	// the pattern and ordering are taken from init() once per workspace, then only the values are refilled.
+	// The model factor is not analyzed in float precision, the workspace then orders its own
+	const bool samePattern = ws.AtA.rows() == m_AtA.rows() && ws.AtA.nonZeros() == m_AtA.nonZeros()
+		&& std::equal(m_AtA.outerIndexPtr(), m_AtA.outerIndexPtr() + m_AtA.cols() + 1, ws.AtA.outerIndexPtr())
+		&& std::equal(m_AtA.innerIndexPtr(), m_AtA.innerIndexPtr() + m_AtA.nonZeros(), ws.AtA.innerIndexPtr());
+	if (!samePattern)
+	{
+		ws.AtA = m_AtA;
+		if (m_solver.permutationP().size() == 0)
+			ws.solver.analyzePattern(ws.AtA);
+		else
+			ws.solver.analyzePattern(ws.AtA, m_solver);
+	}
+	setup_AtA(m_gradientEmphasis ? ws.faceWeights.data() : nullptr, activeWeights(ws), ws.AtA);
+	ws.solver.setNumThreads(getNumThreads());
+	ws.solver.factorize(ws.AtA);
+	if (ws.solver.info() != Eigen::Success)
+	{
+		ws.errStr = "factorization of the workspace AtA failed!";
+		return false;
+	}
+	return true;
+}
+
+bool MeshTransfer::factorize()
+{
+	// ordering and symbolic analysis only once per topology
+	Eigen::ComputationInfo info = Eigen::Success;
+	if (m_solverType == SolverWarmStartPCG)
+	{
+		info = factorize_preconditioner();
+	}
+	else if (m_precision == PrecisionFloat && !m_gradientEmphasis)
+	{
+		info = factorize_float();
+	}
+	else if (m_solverType == SolverSupernodalCholesky)
+	{
+		if (m_shouldAnalysisTopology)
+			m_supernodal.analyzePattern(m_AtA);
+		m_supernodal.setNumThreads(getNumThreads());
+		m_supernodal.factorize(m_AtA);
+		info = m_supernodal.info();
+	}
+	else
+	{
+		if (m_shouldAnalysisTopology)
+			m_solver.analyzePattern(m_AtA);
+		m_solver.setNumThreads(getNumThreads());
+		m_solver.factorize(m_AtA);
+		info = m_solver.info();
+	}
+	m_shouldAnalysisTopology = false;
+	if (info != Eigen::Success)
+	{
+		m_errStr = "factorization of AtA failed!";
+		return false;
+	}
+	return true;
+}
+
+void MeshTransfer::setup_constantAtb(const Weights& w, Mat& Atb)const
+{
+	Atb = m_ancorMat.transpose() * m_ancorRhs * w.anchor
+		+ m_landmarkMat.transpose() * m_landmarkRhs * w.landmark + m_regAtb * w.regularization;
+}
+
+MeshTransfer::Weights MeshTransfer::normalizeWeights(const Weights& weights)const
+{
+	// the number of constraints is counted over all the three coordinates
+	Weights w = weights;
+	w.anchor = real(weights.anchor / (1e-3f + m_ancorMat.rows() * 3));
+	w.landmark = real(weights.landmark / (1e-3f + m_landmarkMat.rows() * 3));
+	w.regularization = real(weights.regularization / (1e-3f + getNumUnknowns() * 3));
+	w.correspond = real(weights.correspond / (1e-3f + m_facesTri.size() * 9));
+	return w;
+}
+
+void MeshTransfer::setup_equilibrate()
+{
+	// S * AtA * S has unit diagonal, the diagonal is the first entry of each column
+	const int n = (int)m_AtA.cols();
+	m_equilibrate.resize(n);
+	for (int j = 0; j < n; j++)
+		m_equilibrate[j] = real(1) / std::sqrt(m_AtA.valuePtr()[m_AtA.outerIndexPtr()[j]]);
+}
+
+Eigen::ComputationInfo MeshTransfer::factorize_float()
+{
+	// equilibrate so that the anchor rows do not dominate the float factor
+	const int n = (int)m_AtA.cols();
+	setup_equilibrate();
+
+	if (m_shouldAnalysisTopology)
+	{
+		m_AtAf = m_AtA.cast<float>();
+		m_AtAf.makeCompressed();
+	}
+	for (int j = 0; j < n; j++)
+	{
+		for (int p = m_AtA.outerIndexPtr()[j]; p < m_AtA.outerIndexPtr()[j + 1]; p++)
+		{
+			const int i = m_AtA.innerIndexPtr()[p];
+			m_AtAf.valuePtr()[p] = float(m_equilibrate[i] * m_AtA.valuePtr()[p] * m_equilibrate[j]);
+		}
+	}
+
+	if (m_solverType == SolverSupernodalCholesky)
+	{
+		if (m_shouldAnalysisTopology)
+			m_supernodalf.analyzePattern(m_AtAf);
+		m_supernodalf.setNumThreads(getNumThreads());
+		m_supernodalf.factorize(m_AtAf);
+		return m_supernodalf.info();
+	}
+	if (m_shouldAnalysisTopology)
+		m_solverf.analyzePattern(m_AtAf);
+	m_solverf.setNumThreads(getNumThreads());
+	m_solverf.factorize(m_AtAf);
+	return m_solverf.info();
+}
+
+Eigen::ComputationInfo MeshTransfer::factorize_preconditioner()
+{
+	// m_AtA is equilibrated in place, so that the CG residual is measured in the scaled norm,
+	// otherwise the heavily weighted anchor rows dominate it
+	const int n = (int)m_AtA.cols();
+	setup_equilibrate();
+	for (int j = 0; j < n; j++)
+	{
+		for (int p = m_AtA.outerIndexPtr()[j]; p < m_AtA.outerIndexPtr()[j + 1]; p++)
+			m_AtA.valuePtr()[p] *= m_equilibrate[m_AtA.innerIndexPtr()[p]] * m_equilibrate[j];
+	}
+
+	// the smooth mode of S * AtA * S is S^-1 * 1, as the translation is the null space of E1
+	if (m_preconditioner == PreconditionerMultigrid)
+	{
+		m_multigrid.compute(m_AtA, m_equilibrate.cwiseInverse());
+		return m_multigrid.info();
+	}
+
+	if (m_shouldAnalysisTopology)
+		m_ichol.analyzePattern(m_AtA);
+	m_ichol.factorize(m_AtA);
+	return m_ichol.info();
+}
+
+// Solve LDL^T * X = P * B * P^T for all columns of B in one pass over the factor.
+// Y is row-major so each entry of L is loaded once and applied to all the columns of a row.
+// With several threads, by the subtrees and levels of the elimination tree, of the same result.
+template<class Solver, class T>
+static void solveMultiRhs(const Solver& solver, const Eigen::Matrix<T, -1, -1>& B,
+	Eigen::Matrix<T, -1, -1, Eigen::RowMajor>& Y, Eigen::Matrix<T, -1, -1>& X)
+{
+	if (solver.hasSolveLevels())
+	{
+		solver.solveLevels(B, Y, X);
+		return;
+	}
+
+	const auto& L = solver.matrixL().nestedExpression();
+	const auto& D = solver.vectorD();
+	const int* P = solver.permutationP().indices().data();
+	const int n = (int)B.rows();
+	const int nCols = (int)B.cols();
+	const int* Lp = L.outerIndexPtr();
+	const int* Li = L.innerIndexPtr();
+	const T* Lx = L.valuePtr();
+
+	Y.resize(n, nCols);
+	for (int i = 0; i < n; i++)
+		Y.row(P[i]) = B.row(i);
+
+	// L * z = y, L unit lower
+	for (int j = 0; j < n; j++)
+	{
+		const T* yj = Y.data() + (size_t)j * nCols;
+		for (int p = Lp[j]; p < Lp[j + 1]; p++)
+		{
+			T* yi = Y.data() + (size_t)Li[p] * nCols;
+			const T v = Lx[p];
+			for (int c = 0; c < nCols; c++)
+				yi[c] -= v * yj[c];
+		}
+	}
+
+	// D * w = z
+	for (int j = 0; j < n; j++)
+		Y.row(j) /= D[j];
+
+	// L^T * x = w
+	for (int j = n - 1; j >= 0; j--)
+	{
+		T* yj = Y.data() + (size_t)j * nCols;
+		for (int p = Lp[j]; p < Lp[j + 1]; p++)
+		{
+			const T* yi = Y.data() + (size_t)Li[p] * nCols;
+			const T v = Lx[p];
+			for (int c = 0; c < nCols; c++)
+				yj[c] -= v * yi[c];
+		}
+	}
+
+	X.resize(n, nCols);
+	for (int i = 0; i < n; i++)
+		X.row(i) = Y.row(P[i]);
+}
+
+bool MeshTransfer::checkSrcVertsDeformed(const std::vector<Float3>& srcVertsDeformed, Workspace& ws)const
+{
+	if (srcVertsDeformed.size() != m_srcVerts0.size())
+	{
+		ws.errStr = "transfer: vertex size not matched!";
+		return false;
+	}
+	if (hasIllegalData((const float*)srcVertsDeformed.data(), (int)srcVertsDeformed.size() * 3))
+	{
+		ws.errStr = "nan or inf in srcVertsDeformed!";
+		return false;
+	}
+	return true;
+}
+
+void MeshTransfer::setup_Atb(const std::vector<Float3>& srcVertsDeformed, int iFrame, Workspace& ws)const
+{
+	// sum all the energy terms, E1 is scattered per face on top of the constant ones
+	ws.Atb.middleCols(iFrame * 3, 3) = ws.ownWeights ? ws.constantAtb : m_anchorRegSumAtb;
+	if (m_gradientEmphasis)
+		ws.faceWeights.resize(m_facesTri.size());
+	if (getNumThreads() > 1)
+		setup_E1Atb_parallel(srcVertsDeformed, iFrame, ws);
+	else
+		setup_E1Atb(srcVertsDeformed, iFrame, ws);
+}
+
+bool MeshTransfer::solve(Workspace& ws)const
+{
+	// x/y/z of all the frames are the columns of the rhs
+	ws.nRefinements = 0;
+	ws.nIterations = 0;
+	ws.hasResidual = true;
+	if (m_solverType == SolverMatrixFreePCG)
+	{
+		solve_pcg(ws);
+		return true;
+	}
+	if (m_solverType == SolverWarmStartPCG)
+	{
+		solve_warmStart(ws);
+		return true;
+	}
+	if (usesWorkspaceFactor(ws))
+	{
+		solveMultiRhs(ws.solver, ws.Atb, ws.solveBuffer, ws.x);
+		ws.hasResidual = false;
+		return true;
+	}
+	if (m_precision == PrecisionDouble)
+	{
+		// the residual costs a product with AtA, a direct solve does not need it, see getResidual()
+		if (m_solverType == SolverSupernodalCholesky)
+			m_supernodal.solve(ws.Atb, ws.solveBuffer, ws.x);
+		else
+			solveMultiRhs(m_solver, ws.Atb, ws.solveBuffer, ws.x);
+		ws.hasResidual = false;
+		return true;
+	}
+
+	// float factor, refined in double: x += S * solve_float(S * (Atb - AtA * x))
+	solve_float(ws.Atb, ws.x, ws);
+	ws.residual = residual(ws);
+	Mat dx;
+	while (ws.nRefinements < MeshTransferParameter::Transfer_Refinement_MaxIterations)
+	{
+		solve_float(ws.r, dx, ws);
+		ws.x += dx;
+		ws.residual = residual(ws);
+		ws.nRefinements++;
+
+		real correction = 0;
+		for (int c = 0; c < dx.cols(); c++)
+			correction = std::max(correction, dx.col(c).norm() / std::max(ws.x.col(c).norm(), std::numeric_limits<real>::min()));
+		if (correction < MeshTransferParameter::Transfer_Refinement_Tolerance)
+			return true;
+	}
+
+	// the float factor is too far from AtA for the refinement to converge, x is not the solution
+	ws.errStr = "the refinement of the float precision solve did not converge!";
+	return false;
+}
+
+void MeshTransfer::solve_float(const Mat& b, Mat& x, Workspace& ws)const
+{
+	ws.bf = (m_equilibrate.asDiagonal() * b).cast<float>();
+	if (m_solverType == SolverSupernodalCholesky)
+		m_supernodalf.solve(ws.bf, ws.solveBufferf, ws.xf);
+	else
+		solveMultiRhs(m_solverf, ws.bf, ws.solveBufferf, ws.xf);
+	x = m_equilibrate.asDiagonal() * ws.xf.cast<real>();
+}
+
+void MeshTransfer::solve_pcg(Workspace& ws)const
+{
+	// each column is an independent PCG, run in lockstep so that AtA is applied to all of them in one pass.
+	// The residual is measured in the Jacobi-scaled norm ||D^(-1/2) * r||, as in the float mode, 
+	// otherwise the heavily weighted anchor rows dominate ||r|| and a small residual does not mean a converged x.
+	const int nCols = (int)ws.Atb.cols();
+	const Vec scale = m_pcgInvDiag.cwiseSqrt();
+	Eigen::Array<real, 1, -1> bNorm(nCols), rz(nCols), rzNew(nCols), alpha(nCols), beta(nCols);
+	for (int c = 0; c < nCols; c++)
+		bNorm[c] = std::max(scale.cwiseProduct(ws.Atb.col(c)).norm(), std::numeric_limits<real>::min());
+	auto relativeResidual = [&]()
+	{
+		return ((scale.asDiagonal() * ws.pcg_r).colwise().norm().array() / bNorm).maxCoeff();
+	};
+
+	ws.pcg_x.setZero(ws.Atb.rows(), nCols);
+	ws.pcg_r = ws.Atb;
+	ws.pcg_z = m_pcgInvDiag.asDiagonal() * ws.pcg_r;
+	ws.pcg_p = ws.pcg_z;
+	rz = ws.pcg_r.cwiseProduct(ws.pcg_z).colwise().sum().array();
+	ws.residual = relativeResidual();
+	while (ws.nIterations < m_pcgMaxIterations && ws.residual > pcgTolerance())
+	{
+		apply_AtA(ws.pcg_p, ws.pcg_q);
+		const Eigen::Array<real, 1, -1> pq = ws.pcg_p.cwiseProduct(ws.pcg_q).colwise().sum().array();
+		for (int c = 0; c < nCols; c++)
+			alpha[c] = pq[c] > 0 ? rz[c] / pq[c] : real(0);
+		ws.pcg_x += ws.pcg_p * alpha.matrix().asDiagonal();
+		ws.pcg_r -= ws.pcg_q * alpha.matrix().asDiagonal();
+		ws.residual = relativeResidual();
+		ws.nIterations++;
+
+		ws.pcg_z = m_pcgInvDiag.asDiagonal() * ws.pcg_r;
+		rzNew = ws.pcg_r.cwiseProduct(ws.pcg_z).colwise().sum().array();
+		for (int c = 0; c < nCols; c++)
+			beta[c] = rz[c] > 0 ? rzNew[c] / rz[c] : real(0);
+		rz = rzNew;
+		ws.pcg_p = ws.pcg_z + ws.pcg_p * beta.matrix().asDiagonal();
+	}
+	ws.x = ws.pcg_x;
+}
+
+MeshTransfer::real MeshTransfer::pcgTolerance()const
+{
+	if (m_pcgTolerance >= 0)
+		return m_pcgTolerance;
+	return m_solverType == SolverWarmStartPCG ? MeshTransferParameter::Transfer_WarmStart_Tolerance
+		: MeshTransferParameter::Transfer_PCG_Tolerance;
+}
+
+void MeshTransfer::solve_warmStart(Workspace& ws)const
+{
+	// frames are solved one by one in order, each started from the previous ones, in the scaled system:
+	// (S * AtA * S) * y = S * Atb, x = S * y
+	const int n = (int)ws.Atb.rows();
+	const int nFrames = (int)ws.Atb.cols() / 3;
+	checkModelVersion(ws);
+	if (ws.nHistory > 0 && ws.xHistory[1].rows() != n)
+		ws.nHistory = 0;
+
+	ws.x.resize(n, ws.Atb.cols());
+	ws.residual = 0;
+	Vec b, y;
+	for (int iFrame = 0; iFrame < nFrames; iFrame++)
+	{
+		auto x = ws.x.middleCols(iFrame * 3, 3);
+		if (ws.nHistory >= 2 && m_warmStartExtrapolation)
+			x = ws.xHistory[1] * 2 - ws.xHistory[0];
+		else if (ws.nHistory >= 1)
+			x = ws.xHistory[1];
+		else
+			x.setZero();
+
+		int nIterations = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			b = m_equilibrate.cwiseProduct(ws.Atb.col(iFrame * 3 + k));
+			y = x.col(k).cwiseQuotient(m_equilibrate);
+			Eigen::Index iters = m_pcgMaxIterations;
+			real tol = pcgTolerance();
+			if (m_preconditioner == PreconditionerMultigrid)
+				Eigen::internal::conjugate_gradient(m_AtA.selfadjointView<Eigen::Lower>(), b, y, m_multigrid, iters, tol);
+			else
+				Eigen::internal::conjugate_gradient(m_AtA.selfadjointView<Eigen::Lower>(), b, y, m_ichol, iters, tol);
+			x.col(k) = m_equilibrate.cwiseProduct(y);
+			nIterations = std::max(nIterations, (int)iters);
+			ws.residual = std::max(ws.residual, tol);
+		}
+		ws.nIterations += nIterations;
+
+		ws.xHistory[0].swap(ws.xHistory[1]);
+		ws.xHistory[1] = x;
+		ws.nHistory = std::min(ws.nHistory + 1, 2);
+	}
+}
+
+// y += w * C^T * C * x for the constraint rows C
+static void applyConstraint(const MeshTransfer::SpMatR& C, real w, const MeshTransfer::MatR& x, MeshTransfer::MatR& y)
+{
+	Eigen::Matrix<real, 1, -1> cx(x.cols());
+	for (int r = 0; r < C.rows(); r++)
+	{
+		cx.setZero();
+		for (MeshTransfer::SpMatR::InnerIterator it(C, r); it; ++it)
+			cx += it.value() * x.row(it.index());
+		for (MeshTransfer::SpMatR::InnerIterator it(C, r); it; ++it)
+			y.row(it.index()) += w * it.value() * cx;
+	}
+}
+
+void MeshTransfer::apply_AtA(const MatR& x, MatR& y)const
+{
+	const int nCols = (int)x.cols();
+	const int nPoints = getNumFacePoints();
+
+	// isolated-point regularization, anchors and landmarks
+	y = x * m_w.regularization;
+	applyConstraint(m_ancorMat, m_w.anchor, x, y);
+	applyConstraint(m_landmarkMat, m_w.landmark, x, y);
+
+	// E1: y += w1 * Ti^T * Ti * x per face, faces of the same color write disjoint rows,
+	// x/y are row-major so all the columns of an unknown are contiguous
+#pragma omp parallel num_threads(getNumThreads())
+	{
+		std::vector<real> Tx(3 * nCols);
+		for (size_t iColor = 0; iColor + 1 < m_colorFaceStart.size(); iColor++)
+		{
+#pragma omp for schedule(static)
+			for (int p = m_colorFaceStart[iColor]; p < m_colorFaceStart[iColor + 1]; p++)
+			{
+				const int iFace = m_colorFaces[p];
+				const int* id = m_E1Mat.innerIndexPtr() + iFace * 3 * nPoints;
+				const real* T = m_E1Mat.valuePtr() + iFace * 3 * nPoints;
+				std::fill(Tx.begin(), Tx.end(), real(0));
+				for (int k = 0; k < nPoints; k++)
+				{
+					const real* xk = x.data() + (size_t)id[k] * nCols;
+					for (int r = 0; r < 3; r++)
+					{
+						const real t = T[r * nPoints + k];
+						for (int c = 0; c < nCols; c++)
+							Tx[r * nCols + c] += t * xk[c];
+					}
+				}
+				for (int k = 0; k < nPoints; k++)
+				{
+					real* yk = y.data() + (size_t)id[k] * nCols;
+					const real t0 = m_w.correspond * T[k], t1 = m_w.correspond * T[nPoints + k], t2 = m_w.correspond * T[2 * nPoints + k];
+					for (int c = 0; c < nCols; c++)
+						yk[c] += t0 * Tx[c] + t1 * Tx[nCols + c] + t2 * Tx[2 * nCols + c];
+				}
+			}
+		}
+	}
+}
+
+void MeshTransfer::setup_pcgPreconditioner()
+{
+	const int nFaces = (int)m_facesTri.size();
+	const int nPoints = getNumFacePoints();
+	Vec diag = Vec::Constant(getNumUnknowns(), m_w.regularization);
+	for (int iFace = 0; iFace < nFaces; iFace++)
+	{
+		const int* id = m_E1Mat.innerIndexPtr() + iFace * 3 * nPoints;
+		const real* T = m_E1Mat.valuePtr() + iFace * 3 * nPoints;
+		for (int k = 0; k < nPoints; k++)
+			diag[id[k]] += m_w.correspond * (T[k] * T[k] + T[nPoints + k] * T[nPoints + k] + T[2 * nPoints + k] * T[2 * nPoints + k]);
+	}
+	diag += m_w.anchor * m_ancorMat.cwiseAbs2().transpose() * Vec::Ones(m_ancorMat.rows());
+	diag += m_w.landmark * m_landmarkMat.cwiseAbs2().transpose() * Vec::Ones(m_landmarkMat.rows());
+	m_pcgInvDiag = diag.cwiseInverse();
+}
+
+MeshTransfer::real MeshTransfer::getResidual(Workspace& ws)const
+{
+	if (!ws.hasResidual)
+	{
+		ws.residual = residual(ws);
+		ws.hasResidual = true;
+	}
+	return ws.residual;
+}
+
+MeshTransfer::real MeshTransfer::residual(Workspace& ws)const
+{
+	// AtA only stores its lower triangular part
+	const SpMat& AtA = usesWorkspaceFactor(ws) ? ws.AtA : m_AtA;
+	ws.r = ws.Atb;
+	ws.r.noalias() -= AtA.selfadjointView<Eigen::Lower>() * ws.x;
+	real res = 0;
+	for (int c = 0; c < ws.r.cols(); c++)
+		res = std::max(res, ws.r.col(c).norm() / std::max(ws.Atb.col(c).norm(), std::numeric_limits<real>::min()));
+	return res;
+}
+
+bool MeshTransfer::transfer(const std::vector<Float3>& srcVertsDeformed, std::vector<Float3>& tarVertsDeformed)
+{
+	if (!transfer(srcVertsDeformed, tarVertsDeformed, m_workspace))
+	{
+		m_errStr = m_workspace.errStr;
+		return false;
+	}
+	return true;
+}
+
+bool MeshTransfer::transfer(const std::vector<Float3>& srcVertsDeformed, 
+	std::vector<Float3>& tarVertsDeformed, Workspace& ws)const
+{
+	if (!m_bInit)
+	{
+		ws.errStr = "not initialized when calling transfer()";
+		return false;
+	}
+	if (!checkSrcVertsDeformed(srcVertsDeformed, ws))
+		return false;
+
+	ws.Atb.resize(getNumUnknowns(), 3);
+	setup_Atb(srcVertsDeformed, 0, ws);
+	if (m_gradientEmphasis && !factorize_workspace(ws))
+		return false;
+	if (!solve(ws))
+		return false;
+
+	// return the value
+	vertex_vec_to_point(ws.x, tarVertsDeformed);
+
+	if (hasIllegalData((const float*)tarVertsDeformed.data(), (int)tarVertsDeformed.size() * 3))
+	{
+		ws.errStr = "finished transfer, but nan or inf in tarVertsDeformed!";
+		return false;
+	}
+	return true;
+}
+
+bool MeshTransfer::transferBatch(const std::vector<std::vector<Float3>>& srcVertsDeformed,
+	std::vector<std::vector<Float3>>& tarVertsDeformed)
+{
+	if (!transferBatch(srcVertsDeformed, tarVertsDeformed, m_workspace))
+	{
+		m_errStr = m_workspace.errStr;
+		return false;
+	}
+	return true;
+}
+
+bool MeshTransfer::transferBatch(const std::vector<std::vector<Float3>>& srcVertsDeformed,
+	std::vector<std::vector<Float3>>& tarVertsDeformed, Workspace& ws)const
+{
+	if (!m_bInit)
+	{
+		ws.errStr = "not initialized when calling transferBatch()";
+		return false;
+	}
+	for (size_t iFrame = 0; iFrame < srcVertsDeformed.size(); iFrame++)
+	{
+		if (!checkSrcVertsDeformed(srcVertsDeformed[iFrame], ws))
+			return false;
+	}
+
+	// nothing to solve, the solvers assume at least one column
+	const int nFrames = (int)srcVertsDeformed.size();
+	if (nFrames == 0)
+	{
+		tarVertsDeformed.clear();
+		return true;
+	}
+
+	// each frame has its own weighted AtA, no pass over a common factor to share
+	if (m_gradientEmphasis)
+	{
+		tarVertsDeformed.resize(nFrames);
+		for (int iFrame = 0; iFrame < nFrames; iFrame++)
+		{
+			if (!transfer(srcVertsDeformed[iFrame], tarVertsDeformed[iFrame], ws))
+				return false;
+		}
+		return true;
+	}
+
+	ws.Atb.resize(getNumUnknowns(), nFrames * 3);
+	for (int iFrame = 0; iFrame < nFrames; iFrame++)
+		setup_Atb(srcVertsDeformed[iFrame], iFrame, ws);
+	if (!solve(ws))
+		return false;
+
+	// return the value
+	tarVertsDeformed.resize(nFrames);
+	for (int iFrame = 0; iFrame < nFrames; iFrame++)
+	{
+		vertex_vec_to_point(ws.x.middleCols(iFrame * 3, 3), tarVertsDeformed[iFrame]);
+		if (hasIllegalData((const float*)tarVertsDeformed[iFrame].data(), (int)tarVertsDeformed[iFrame].size() * 3))
+		{
+			ws.errStr = "finished transferBatch, but nan or inf in tarVertsDeformed!";
+			return false;
+		}
+	}
+	return true;
+}
+
+void MeshTransfer::clear()
+{
+	m_bInit = false;
+	m_shouldAnalysisTopology = true;
+	m_facesTri.clear();
+	m_anchors.clear();
+	m_srcVerts0.clear();
+	m_srcOpA.clear();
+	m_srcFaceInvalid.clear();
+	modelChanged();
+	clear_blendshapeBasis();
+}
+
+int MeshTransfer::getNumThreads()const
+{
+	return m_nThreads > 0 ? m_nThreads : omp_get_max_threads();
+}
+
+int MeshTransfer::getNumFacePoints()const
+{
+	return m_formulation == FormulationVertexOnly ? 3 : 4;
+}
+
+int MeshTransfer::getNumUnknowns()const
+{
+	if (m_formulation == FormulationVertexOnly)
+		return (int)m_srcVerts0.size();
+	return (int)m_srcVerts0.size() + (int)m_facesTri.size();
+}
+
+void MeshTransfer::findAnchorPoints()
+{
+	// ldp: may be we should manually specify anchor points
+	//		to make the results' global position reasonable
+	m_anchors.clear();
+	m_anchors.push_back(0);
+}
+
+void MeshTransfer::vertex_vec_to_point(const Eigen::Ref<const Mat>& x, std::vector<Float3>& verts)const
+{
+	verts.resize(m_srcVerts0.size());
+	for (int i = 0; i < verts.size(); i++)
+		for (int k = 0; k < 3; k++)
+			verts[i][k] = (float)x(i, k);
+}
+
+void MeshTransfer::vertex_point_to_vec(Mat& x, const std::vector<Float3>& verts, const std::vector<Int3>& faces)const
+{
+	int nTotalVerts = (int)verts.size() + (int)faces.size();
+	x.resize(nTotalVerts, 3);
+
+	x.setZero();
+	for (int i = 0; i < verts.size(); i++)
+		for (int k = 0; k < 3; k++)
+			x(i, k) = verts[i][k];
+
+	for (int i = 0; i < faces.size(); i++)
+	{
+		int row = (int)verts.size() + i;
+		const Int3& f = faces[i];
+		Float3 v = verts[f[0]] + (verts[f[1]] - verts[f[0]]).cross(verts[f[2]] - verts[f[0]]).normalized();
+		for (int k = 0; k < 3; k++)
+			x(row, k) = v[k];
+	}
+}
+
+// The per-face kernels below process FACE_LANES faces at once, one face per SIMD lane
+// (4/8/16 for SSE/AVX/AVX-512), on structure-of-arrays data: v[c * 3 + k][lane] is the
+// coordinate k of the c-th corner of the face of that lane.
+typedef Eigen::internal::packet_traits<float>::type PacketF;
+enum { FACE_LANES = Eigen::internal::packet_traits<float>::size };
+typedef float LaneF[FACE_LANES];
+
+// gather the 3 corners of faces [iFace0, iFace0 + FACE_LANES), the lanes after nFaces repeat the last face
+inline void gatherFaceCorners(int iFace0, const std::vector<Int3>& faces, const std::vector<Float3>& verts, LaneF* v)
+{
+	const int nFaces = (int)faces.size();
+	for (int l = 0; l < FACE_LANES; l++)
+	{
+		const Int3& f = faces[std::min(iFace0 + l, nFaces - 1)];
+		for (int c = 0; c < 3; c++)
+			for (int k = 0; k < 3; k++)
+				v[c * 3 + k][l] = verts[f[c]][k];
+	}
+}
+
+// gather the 3 corners of the faces listed in iFaces[0, nLanes), the other lanes repeat the last face
+inline void gatherFaceCorners(const int* iFaces, int nLanes, const std::vector<Int3>& faces, 
+	const std::vector<Float3>& verts, LaneF* v)
+{
+	for (int l = 0; l < FACE_LANES; l++)
+	{
+		const Int3& f = faces[iFaces[std::min(l, nLanes - 1)]];
+		for (int c = 0; c < 3; c++)
+			for (int k = 0; k < 3; k++)
+				v[c * 3 + k][l] = verts[f[c]][k];
+	}
+}
+
+// the auxiliary 4th vertex of each face: v[3] = v[0] + normalized((v[1]-v[0]) x (v[2]-v[0]))
+// as Eigen's normalized(), a zero normal is kept zero
+inline void getNormalVertex(const LaneF* v, LaneF* v3)
+{
+	using namespace Eigen::internal;
+	PacketF e1[3], e2[3], n[3];
+	for (int k = 0; k < 3; k++)
+	{
+		e1[k] = psub(pload<PacketF>(v[3 + k]), pload<PacketF>(v[k]));
+		e2[k] = psub(pload<PacketF>(v[6 + k]), pload<PacketF>(v[k]));
+	}
+	n[0] = psub(pmul(e1[1], e2[2]), pmul(e1[2], e2[1]));
+	n[1] = psub(pmul(e1[2], e2[0]), pmul(e1[0], e2[2]));
+	n[2] = psub(pmul(e1[0], e2[1]), pmul(e1[1], e2[0]));
+	const PacketF len2 = padd(padd(pmul(n[0], n[0]), pmul(n[1], n[1])), pmul(n[2], n[2]));
+	const PacketF nonZero = pcmp_lt(pzero(len2), len2);
+	const PacketF len = psqrt(len2);
+	for (int k = 0; k < 3; k++)
+		pstore(v3[k], padd(pload<PacketF>(v[k]), pand(nonZero, pdiv(n[k], len))));
+}
+
+// The per-face 3x4 operator A, such that A * [x0 x1 x2 x3]^T is the gradient of a linear function 
+// given its values on the 4 vertices. The full matrix T is in block diag style:
+// | A 0 0 |
+// | 0 A 0 |
+// | 0 0 A |
+// where each A is a 3x4 matrix, identical for x/y/z.
+// With V = [v1-v0, v2-v0, v3-v0], A(:, 1:3) = V^-T and A(:, 0) = -sum(A(:, 1:3)), where V^-1 is 
+// given by the cofactors: its rows are (e2 x e3, e3 x e1, e1 x e2) / det(V).
+// For the vertex-only formulation there is no v3 and the in-plane gradient is given by the 
+// pseudo-inverse of the edge matrix E = [v1-v0, v2-v0], i.e., A(:, 1:2) = E * (E^T * E)^-1, A(:, 3) = 0.
+// A[y * 4 + x][lane] is A(y, x) of that lane. Degenerated faces get a zero A and are returned in the lane mask.
+template<bool VertexOnly>
+inline PacketF getMatrix_namedby_T(const LaneF* v, LaneF* A)
+{
+	using namespace Eigen::internal;
+	PacketF e[3][3], Vinv[3][3];
+	for (int k = 0; k < 3; k++)
+	{
+		e[0][k] = psub(pload<PacketF>(v[3 + k]), pload<PacketF>(v[k]));
+		e[1][k] = psub(pload<PacketF>(v[6 + k]), pload<PacketF>(v[k]));
+	}
+
+	if (VertexOnly)
+	{
+		// (E^T * E)^-1 = [c -b; -b a] / (a*c - b*b)
+		const PacketF a = padd(padd(pmul(e[0][0], e[0][0]), pmul(e[0][1], e[0][1])), pmul(e[0][2], e[0][2]));
+		const PacketF b = padd(padd(pmul(e[0][0], e[1][0]), pmul(e[0][1], e[1][1])), pmul(e[0][2], e[1][2]));
+		const PacketF c = padd(padd(pmul(e[1][0], e[1][0]), pmul(e[1][1], e[1][1])), pmul(e[1][2], e[1][2]));
+		const PacketF invDet = pdiv(pset1<PacketF>(1.f), psub(pmul(a, c), pmul(b, b)));
+		for (int k = 0; k < 3; k++)
+		{
+			Vinv[0][k] = pmul(psub(pmul(c, e[0][k]), pmul(b, e[1][k])), invDet);
+			Vinv[1][k] = pmul(psub(pmul(a, e[1][k]), pmul(b, e[0][k])), invDet);
+			Vinv[2][k] = pzero(a);
+		}
+	}
+	else
+	{
+		EIGEN_ALIGN_MAX LaneF v3[3];
+		getNormalVertex(v, v3);
+		for (int k = 0; k < 3; k++)
+			e[2][k] = psub(pload<PacketF>(v3[k]), pload<PacketF>(v[k]));
+
+		for (int r = 0; r < 3; r++)
+		{
+			const PacketF* p = e[(r + 1) % 3];
+			const PacketF* q = e[(r + 2) % 3];
+			Vinv[r][0] = psub(pmul(p[1], q[2]), pmul(p[2], q[1]));
+			Vinv[r][1] = psub(pmul(p[2], q[0]), pmul(p[0], q[2]));
+			Vinv[r][2] = psub(pmul(p[0], q[1]), pmul(p[1], q[0]));
+		}
+		const PacketF det = padd(padd(pmul(e[0][0], Vinv[0][0]), pmul(e[0][1], Vinv[0][1])), pmul(e[0][2], Vinv[0][2]));
+		const PacketF invDet = pdiv(pset1<PacketF>(1.f), det);
+		for (int r = 0; r < 3; r++)
+			for (int k = 0; k < 3; k++)
+				Vinv[r][k] = pmul(Vinv[r][k], invDet);
+	}
+
+	// A(y, x+1) = V^-1(x, y), and all must be finite
+	PacketF Ap[12];
+	PacketF valid = ptrue(pzero(Ap[0]));
+	const PacketF fltMax = pset1<PacketF>(std::numeric_limits<float>::max());
+	for (int y = 0; y < 3; y++)
+	{
+		Ap[y * 4 + 0] = pnegate(padd(padd(Vinv[0][y], Vinv[1][y]), Vinv[2][y]));
+		for (int x = 0; x < 3; x++)
+			Ap[y * 4 + x + 1] = Vinv[x][y];
+		for (int x = 0; x < 4; x++)
+			valid = pand(valid, pcmp_le(pabs(Ap[y * 4 + x]), fltMax));
+	}
+	for (int i = 0; i < 12; i++)
+		pstore(A[i], pand(valid, Ap[i]));
+	return pandnot(ptrue(valid), valid);
+}
+
+// lane mask to per-lane flags
+inline void getLaneFlags(const PacketF& mask, bool* flags)
+{
+	EIGEN_ALIGN_MAX float m[FACE_LANES];
+	Eigen::internal::pstore(m, mask);
+	for (int l = 0; l < FACE_LANES; l++)
+		flags[l] = Eigen::numext::bit_cast<unsigned int>(m[l]) != 0;
+}
+
+// Allocate a compressed sparse matrix whose outer vectors all have exactly nPerOuter entries,
+// the inner indices and values are then filled directly without any triplets or sorting.
+template<class SpMatType>
+static void resizeCompressed(SpMatType& M, int rows, int cols, int nPerOuter)
+{
+	M.resize(rows, cols);
+	M.resizeNonZeros((Eigen::Index)M.outerSize() * nPerOuter);
+	for (Eigen::Index i = 0; i <= M.outerSize(); i++)
+		M.outerIndexPtr()[i] = int(i * nPerOuter);
+}
+
+inline void fillCompressedRows_by_Mat(MeshTransfer::SpMatR& M, int row,
+	int nPoints, const int* id, const Eigen::Matrix<real, 3, 4>& T)
+{
+	// The full matrix T is in block diag style:
+	// | A 0 0 |
+	// | 0 A 0 |
+	// | 0 0 A |
+	// where each A is a 3xnPoints matrix, identical for x/y/z, thus we only push A.
+	// Each row of A is pushed with sorted column ids, the auxiliary vertex id[3] is always the largest.
+	int order[4] = { 0, 1, 2, 3 };
+	for (int i = 1; i < 3; i++)
+		for (int j = i; j > 0 && id[order[j]] < id[order[j - 1]]; j--)
+			std::swap(order[j], order[j - 1]);
+
+	const static int nCoords = 3;
+	int* inner = M.innerIndexPtr() + row * nPoints;
+	real* value = M.valuePtr() + row * nPoints;
+	for (int y = 0; y < nCoords; y++)
+	{
+		for (int x = 0; x < nPoints; x++)
+		{
+			*inner++ = id[order[x]];
+			*value++ = T(y, order[x]);
+		}
+	}
+}
+
+void MeshTransfer::setup_E1Mat(const std::vector<Float3>& tarVerts0)
+{
+	const int nTotalVerts = getNumUnknowns();
+	const int nPoints = getNumFacePoints();
+	resizeCompressed(m_E1Mat, (int)m_facesTri.size() * 3, nTotalVerts, nPoints);
+
+	const int nFaces = (int)m_facesTri.size();
+	const int nGroups = (nFaces + FACE_LANES - 1) / FACE_LANES;
+
+	// each face writes its own rows, thus no conflicts among threads
+#pragma omp parallel for num_threads(getNumThreads()) schedule(static)
+	for (int iGroup = 0; iGroup < nGroups; iGroup++)
+	{
+		const int iFace0 = iGroup * FACE_LANES;
+		const int nLanes = std::min((int)FACE_LANES, nFaces - iFace0);
+		int iFaces[FACE_LANES];
+		for (int l = 0; l < nLanes; l++)
+			iFaces[l] = iFace0 + l;
+		setup_E1Faces(iFaces, nLanes, tarVerts0);
+	}
+}
+
+// the rows of E1 of the faces iFaces[0, nLanes), in the pattern already allocated by setup_E1Mat()
+void MeshTransfer::setup_E1Faces(const int* iFaces, int nLanes, const std::vector<Float3>& tarVerts0)
+{
+	const bool vertexOnly = m_formulation == FormulationVertexOnly;
+	const int nPoints = vertexOnly ? 3 : 4;
+	const int nMeshVerts = (int)tarVerts0.size();
+	Eigen::Matrix<real, 3, 4> Ti;
+	EIGEN_ALIGN_MAX LaneF v[9], A[12];
+	bool inValid[FACE_LANES];
+	Int4 id_vi_tar;
+
+	// face_i_tar, the degenerated ones get zero matrices
+	gatherFaceCorners(iFaces, nLanes, m_facesTri, tarVerts0, v);
+	if (vertexOnly)
+		getLaneFlags(getMatrix_namedby_T<true>(v, A), inValid);
+	else
+		getLaneFlags(getMatrix_namedby_T<false>(v, A), inValid);
+
+	for (int l = 0; l < nLanes; l++)
+	{
+		const int iFace = iFaces[l];
+		for (int k = 0; k < 3; k++)
+			id_vi_tar[k] = m_facesTri[iFace][k];
+		id_vi_tar[3] = nMeshVerts + iFace;
+		for (int y = 0; y < 3; y++)
+			for (int x = 0; x < 4; x++)
+				Ti(y, x) = A[y * 4 + x][l];
+
+		// push matrix
+		const int row = iFace * 3;
+		fillCompressedRows_by_Mat(m_E1Mat, row, nPoints, id_vi_tar.data(), Ti);
+	}
+}
+
+void MeshTransfer::setup_srcOperators(const std::vector<Float3>& srcVerts0)
+{
+	// A0 never changes, so its per-face operators are computed only once
+	const int nFaces = (int)m_facesTri.size();
+	m_srcOpA.resize(nFaces * 12);
+	m_srcFaceInvalid.resize(nFaces);
+	const int nGroups = (nFaces + FACE_LANES - 1) / FACE_LANES;
+#pragma omp parallel for num_threads(getNumThreads()) schedule(static)
+	for (int iGroup = 0; iGroup < nGroups; iGroup++)
+	{
+		const int iFace0 = iGroup * FACE_LANES;
+		EIGEN_ALIGN_MAX LaneF v[9], A[12];
+		bool inValid[FACE_LANES];
+		gatherFaceCorners(iFace0, m_facesTri, srcVerts0, v);
+		getLaneFlags(getMatrix_namedby_T<false>(v, A), inValid);
+		for (int l = 0; l < FACE_LANES && iFace0 + l < nFaces; l++)
+		{
+			m_srcFaceInvalid[iFace0 + l] = inValid[l];
+			for (int i = 0; i < 12; i++)
+				m_srcOpA[i * nFaces + iFace0 + l] = A[i][l];
+		}
+	}
+}
+
+// For the faces iFaces[0, nLanes): Si_b = Si_A * Si_x with the cached gradient transfer matrix
+static void getSrcGradients(const int* iFaces, int nLanes, const std::vector<Int3>& faces,
+	const std::vector<Float3>& srcVertsDeformed, const std::vector<float>& srcOpA, real b[FACE_LANES][3][3])
+{
+	const int nFaces = (int)faces.size();
+	EIGEN_ALIGN_MAX LaneF v[12];
+
+	// face_i_src, with the 4th vertex at v[9..11]
+	gatherFaceCorners(iFaces, nLanes, faces, srcVertsDeformed, v);
+	getNormalVertex(v, v + 9);
+
+	for (int l = 0; l < nLanes; l++)
+	{
+		for (int y = 0; y < 3; y++)
+		{
+			const float* A = srcOpA.data() + y * 4 * nFaces + iFaces[l];
+			for (int k = 0; k < 3; k++)
+			{
+				b[l][y][k] = 0;
+				for (int x = 0; x < 4; x++)
+					b[l][y][k] += real(A[x * nFaces]) * real(v[x * 3 + k][l]);
+			}
+		}
+	}
+}
+
+// For the faces iFaces[0, nLanes): Atb += w1 * Ti^T * Si_b, with Ti the rows of the face in E1. 
+// If faceWeights is given, the emphasis weights are computed from Si_b into it and applied. The degenerated faces 
+// already have zero matrices. The 3x4 (or 3x3) block of each face is scattered to its own unknowns directly.
+static void scatterE1Atb(const int* iFaces, int nLanes, const std::vector<Int3>& faces,
+	const std::vector<Float3>& srcVertsDeformed, const std::vector<float>& srcOpA,
+	const MeshTransfer::SpMatR& E1, int nPoints, const MeshTransfer::Weights& weights, real* faceWeights, real* Atb[3])
+{
+	real bLanes[FACE_LANES][3][3];
+	getSrcGradients(iFaces, nLanes, faces, srcVertsDeformed, srcOpA, bLanes);
+
+	for (int l = 0; l < nLanes; l++)
+	{
+		const int iFace = iFaces[l];
+		real (&b)[3][3] = bLanes[l];
+
+		// the gradient emphasis: (1 + ||M||_F)^theta / (kappa + ||M||_F)^theta, with M = Si_b - I
+		real w = weights.correspond;
+		if (faceWeights)
+		{
+			real m = 0;
+			for (int y = 0; y < 3; y++)
+				for (int k = 0; k < 3; k++)
+					m += (b[y][k] - real(y == k)) * (b[y][k] - real(y == k));
+			m = std::sqrt(m);
+			faceWeights[iFace] = std::pow((1 + m) / (weights.emphasisKappa + m), weights.emphasisTheta);
+			w *= faceWeights[iFace];
+		}
+
+		const int* id = E1.innerIndexPtr() + iFace * 3 * nPoints;
+		const real* T = E1.valuePtr() + iFace * 3 * nPoints;
+		for (int x = 0; x < nPoints; x++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				real Atb_xk = 0;
+				for (int y = 0; y < 3; y++)
+					Atb_xk += T[y * nPoints + x] * b[y][k];
+				Atb[k][id[x]] += w * Atb_xk;
+			}
+		}
+	}
+}
+
+void MeshTransfer::setup_E1Atb(const std::vector<Float3>& srcVertsDeformed, int iFrame, Workspace& ws)const
+{
+	// the faces in the color order and groups of setup_E1Atb_parallel(), so that each entry of Atb sums
+	// the same terms in the same order, thus the result is bitwise identical for any number of threads
+	const int nPoints = getNumFacePoints();
+	real* Atb[3] = { &ws.Atb(0, iFrame * 3), &ws.Atb(0, iFrame * 3 + 1), &ws.Atb(0, iFrame * 3 + 2) };
+	real* faceWeights = m_gradientEmphasis ? ws.faceWeights.data() : nullptr;
+	for (size_t iColor = 0; iColor + 1 < m_colorFaceStart.size(); iColor++)
+	{
+		for (int p = m_colorFaceStart[iColor]; p < m_colorFaceStart[iColor + 1]; p += FACE_LANES)
+		{
+			const int nLanes = std::min((int)FACE_LANES, m_colorFaceStart[iColor + 1] - p);
+			scatterE1Atb(m_colorFaces.data() + p, nLanes, m_facesTri, srcVertsDeformed, m_srcOpA, m_E1Mat, nPoints, activeWeights(ws), faceWeights, Atb);
+		}
+	}
+}
+
+void MeshTransfer::setup_E1Atb_parallel(const std::vector<Float3>& srcVertsDeformed, int iFrame, Workspace& ws)const
+{
+	// faces of the same color share no unknowns, thus scatter to Atb without conflicts
+	const int nPoints = getNumFacePoints();
+	real* Atb[3] = { &ws.Atb(0, iFrame * 3), &ws.Atb(0, iFrame * 3 + 1), &ws.Atb(0, iFrame * 3 + 2) };
+	real* faceWeights = m_gradientEmphasis ? ws.faceWeights.data() : nullptr;
+#pragma omp parallel num_threads(getNumThreads())
+	for (size_t iColor = 0; iColor + 1 < m_colorFaceStart.size(); iColor++)
+	{
+		const int begin = m_colorFaceStart[iColor];
+		const int nGroups = (m_colorFaceStart[iColor + 1] - begin + FACE_LANES - 1) / FACE_LANES;
+#pragma omp for schedule(static)
+		for (int iGroup = 0; iGroup < nGroups; iGroup++)
+		{
+			const int p = begin + iGroup * FACE_LANES;
+			const int nLanes = std::min((int)FACE_LANES, m_colorFaceStart[iColor + 1] - p);
+			scatterE1Atb(m_colorFaces.data() + p, nLanes, m_facesTri, srcVertsDeformed, m_srcOpA, m_E1Mat, nPoints, activeWeights(ws), faceWeights, Atb);
+		}
+	}
+}
+
+bool MeshTransfer::transferIncremental(const std::vector<Float3>& srcVertsDeformed,
+	std::vector<Float3>& tarVertsDeformed, real tol)
+{
+	if (!transferIncremental(srcVertsDeformed, tarVertsDeformed, tol, m_workspace))
+	{
+		m_errStr = m_workspace.errStr;
+		return false;
+	}
+	return true;
+}
+
+bool MeshTransfer::transferIncremental(const std::vector<Float3>& srcVertsDeformed,
+	std::vector<Float3>& tarVertsDeformed, real tol, Workspace& ws)const
+{
+	if (!m_bInit)
+	{
+		ws.errStr = "not initialized when calling transferIncremental()";
+		return false;
+	}
+	if (!checkSrcVertsDeformed(srcVertsDeformed, ws))
+		return false;
+	const int nFaces = (int)m_facesTri.size();
+	const int nPoints = getNumFacePoints();
+	const bool supported = m_solverType == SolverCholesky && m_precision == PrecisionDouble && !usesWorkspaceFactor(ws);
+
+	// a full transfer starts the sequence
+	checkModelVersion(ws);
+	if (!supported || !ws.hasIncremental)
+	{
+		if (!transfer(srcVertsDeformed, tarVertsDeformed, ws))
+			return false;
+		ws.nChangedFaces = nFaces;
+		if (!supported)
+			return true;
+		ws.incSrcVerts = srcVertsDeformed;
+		ws.incX = ws.x;
+		ws.incGradients.resize(nFaces * 9);
+		int iFaces[FACE_LANES];
+		real b[FACE_LANES][3][3];
+		for (int iFace0 = 0; iFace0 < nFaces; iFace0 += FACE_LANES)
+		{
+			const int nLanes = std::min((int)FACE_LANES, nFaces - iFace0);
+			for (int l = 0; l < nLanes; l++)
+				iFaces[l] = iFace0 + l;
+			getSrcGradients(iFaces, nLanes, m_facesTri, srcVertsDeformed, m_srcOpA, b);
+			for (int l = 0; l < nLanes; l++)
+				std::copy(&b[l][0][0], &b[l][0][0] + 9, ws.incGradients.data() + (iFace0 + l) * 9);
+		}
+		ws.hasIncremental = true;
+		return true;
+	}
+
+	// only the faces around the moved vertices may have changed
+	std::vector<char> isCandidate(nFaces, 0);
+	std::vector<int> candidates;
+	for (int i = 0; i < (int)srcVertsDeformed.size(); i++)
+	{
+		if (srcVertsDeformed[i] == ws.incSrcVerts[i])
+			continue;
+		ws.incSrcVerts[i] = srcVertsDeformed[i];
+		for (int p = m_unknownFaceStart[i]; p < m_unknownFaceStart[i + 1]; p++)
+		{
+			if (!isCandidate[m_unknownFaces[p]])
+			{
+				isCandidate[m_unknownFaces[p]] = 1;
+				candidates.push_back(m_unknownFaces[p]);
+			}
+		}
+	}
+
+	// the delta rhs w1 * Ti^T * (Si_b - Si_b_last) of the changed faces
+	ws.incB.setZero(getNumUnknowns(), 3);
+	ws.nChangedFaces = 0;
+	std::vector<int> rows;
+	real b[FACE_LANES][3][3];
+	for (size_t c0 = 0; c0 < candidates.size(); c0 += FACE_LANES)
+	{
+		const int nLanes = std::min((int)FACE_LANES, int(candidates.size() - c0));
+		getSrcGradients(candidates.data() + c0, nLanes, m_facesTri, srcVertsDeformed, m_srcOpA, b);
+		for (int l = 0; l < nLanes; l++)
+		{
+			const int iFace = candidates[c0 + l];
+			real* last = ws.incGradients.data() + iFace * 9;
+			real db[3][3], diff = 0;
+			for (int y = 0; y < 3; y++)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					db[y][k] = b[l][y][k] - last[y * 3 + k];
+					diff = std::max(diff, std::abs(db[y][k]));
+				}
+			}
+			if (diff <= tol)
+				continue;
+			std::copy(&b[l][0][0], &b[l][0][0] + 9, last);
+			ws.nChangedFaces++;
+
+			const int* id = m_E1Mat.innerIndexPtr() + iFace * 3 * nPoints;
+			const real* T = m_E1Mat.valuePtr() + iFace * 3 * nPoints;
+			for (int x = 0; x < nPoints; x++)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					real Atb_xk = 0;
+					for (int y = 0; y < 3; y++)
+						Atb_xk += T[y * nPoints + x] * db[y][k];
+					ws.incB(id[x], k) += m_w.correspond * Atb_xk;
+				}
+				rows.push_back(id[x]);
+			}
+		}
+	}
+	if (!rows.empty())
+	{
+		m_solver.solveSparseRhs(rows, ws.incB, ws.incDx, ws.incBuffer);
+		ws.incX += ws.incDx;
+	}
+
+	vertex_vec_to_point(ws.incX, tarVertsDeformed);
+	if (hasIllegalData((const float*)tarVertsDeformed.data(), (int)tarVertsDeformed.size() * 3))
+	{
+		ws.errStr = "finished transferIncremental, but nan or inf in tarVertsDeformed!";
+		return false;
+	}
+	return true;
+}
+
+void MeshTransfer::setup_ancorMat()
+{
+	const int nTotalVerts = getNumUnknowns();
+	resizeCompressed(m_ancorMat, (int)m_anchors.size(), nTotalVerts, 1);
+
+	// build matrix, one nonzero per row
+	for (int i = 0; i < m_anchors.size(); i++)
+	{
+		m_ancorMat.innerIndexPtr()[i] = m_anchors[i];
+		m_ancorMat.valuePtr()[i] = 1;
+	}
+}
+
+void MeshTransfer::setup_ancorRhs(const std::vector<Float3>& tarVerts0)
+{
+	const int nMeshVerts = (int)tarVerts0.size();
+	const int nTotalVerts = nMeshVerts + (int)m_facesTri.size();
+	m_ancorRhs.resize((int)m_anchors.size(), 3);
+	m_ancorRhs.setZero();
+
+	// build matrix
+	for (int i = 0; i < m_anchors.size(); i++)
+	{
+		for (int k = 0; k<3; k++)
+			m_ancorRhs(i, k) = tarVerts0[m_anchors[i]][k];
+	}
+}
+
+void MeshTransfer::setup_landmarkMat()
+{
+	const int nTotalVerts = getNumUnknowns();
+	std::vector<Eigen::Triplet<real>> triplets;
+	for (int i = 0; i < (int)m_landmarks.size(); i++)
+	{
+		for (int k = 0; k < 4; k++)
+		{
+			if (m_landmarks[i].weights[k] != 0)
+				triplets.push_back(Eigen::Triplet<real>(i, m_landmarks[i].verts[k], m_landmarks[i].weights[k]));
+		}
+	}
+
+	// duplicated vertices of a landmark are summed
+	m_landmarkMat.resize((int)m_landmarks.size(), nTotalVerts);
+	m_landmarkMat.setFromTriplets(triplets.begin(), triplets.end());
+}
+
+void MeshTransfer::setup_landmarkRhs(const std::vector<Float3>& tarVerts0)
+{
+	// the landmarks stay at their positions on B0 unless moved by setLandmarkTargets()
+	m_landmarkRhs.resize((int)m_landmarks.size(), 3);
+	m_landmarkRhs.setZero();
+	for (int i = 0; i < (int)m_landmarks.size(); i++)
+	{
+		for (int k = 0; k < 4; k++)
+		{
+			if (m_landmarks[i].weights[k] == 0)
+				continue;
+			for (int c = 0; c < 3; c++)
+				m_landmarkRhs(i, c) += m_landmarks[i].weights[k] * tarVerts0[m_landmarks[i].verts[k]][c];
+		}
+	}
+}
+
+// index of the pair (a, b), b <= a, in the packed lower triangle
+inline int lowerPairIndex(int a, int b)
+{
+	return a * (a + 1) / 2 + b;
+}
+
+// position of entry (row, col) in the lower-triangular column-major pattern
+inline int findLowerEntry(const MeshTransfer::SpMat& M, int row, int col)
+{
+	const int* begin = M.innerIndexPtr() + M.outerIndexPtr()[col];
+	const int* end = M.innerIndexPtr() + M.outerIndexPtr()[col + 1];
+	return int(std::lower_bound(begin, end, row) - M.innerIndexPtr());
+}
+
+void MeshTransfer::setup_faceColoring()
+{
+	// the sorted unknown ids of each face are the column ids of its rows in m_E1Mat
+	const int nTotalVerts = getNumUnknowns();
+	const int nFaces = (int)m_facesTri.size();
+	const int nPoints = getNumFacePoints();
+	auto faceIds = [&](int iFace) { return m_E1Mat.innerIndexPtr() + iFace * 3 * nPoints; };
+
+	// faces incident to each unknown
+	m_unknownFaceStart.assign(nTotalVerts + 1, 0);
+	m_unknownFaces.resize(nFaces * nPoints);
+	for (int iFace = 0; iFace < nFaces; iFace++)
+		for (int x = 0; x < nPoints; x++)
+			m_unknownFaceStart[faceIds(iFace)[x] + 1]++;
+	for (int i = 0; i < nTotalVerts; i++)
+		m_unknownFaceStart[i + 1] += m_unknownFaceStart[i];
+	std::vector<int> pos(m_unknownFaceStart.begin(), m_unknownFaceStart.end() - 1);
+	for (int iFace = 0; iFace < nFaces; iFace++)
+		for (int x = 0; x < nPoints; x++)
+			m_unknownFaces[pos[faceIds(iFace)[x]]++] = iFace;
+
+	// greedy face coloring, faces sharing an unknown get different colors
+	std::vector<int> faceColor(nFaces, -1), colorMark, colorSize;
+	for (int iFace = 0; iFace < nFaces; iFace++)
+	{
+		for (int x = 0; x < nPoints; x++)
+		{
+			const int v = faceIds(iFace)[x];
+			for (int p = m_unknownFaceStart[v]; p < m_unknownFaceStart[v + 1]; p++)
+			{
+				const int c = faceColor[m_unknownFaces[p]];
+				if (c >= 0)
+					colorMark[c] = iFace;
+			}
+		}
+		int c = 0;
+		while (c < (int)colorMark.size() && colorMark[c] == iFace)
+			c++;
+		if (c == (int)colorMark.size())
+		{
+			colorMark.push_back(-1);
+			colorSize.push_back(0);
+		}
+		faceColor[iFace] = c;
+		colorSize[c]++;
+	}
+	m_colorFaceStart.assign(colorSize.size() + 1, 0);
+	for (size_t c = 0; c < colorSize.size(); c++)
+		m_colorFaceStart[c + 1] = m_colorFaceStart[c] + colorSize[c];
+	m_colorFaces.resize(nFaces);
+	pos.assign(m_colorFaceStart.begin(), m_colorFaceStart.end() - 1);
+	for (int iFace = 0; iFace < nFaces; iFace++)
+		m_colorFaces[pos[faceColor[iFace]]++] = iFace;
+}
+
+void MeshTransfer::setup_AtAPattern()
+{
+	const int nTotalVerts = getNumUnknowns();
+	const int nFaces = (int)m_facesTri.size();
+	const int nPoints = getNumFacePoints();
+	const int nPairs = lowerPairIndex(nPoints, 0);
+	auto faceIds = [&](int iFace) { return m_E1Mat.innerIndexPtr() + iFace * 3 * nPoints; };
+	setup_faceColoring();
+
+	// the lower-triangular pattern: column j holds j itself and the larger unknowns sharing a face
+	// or a landmark with j; the vertices of a landmark on a quad need not share a triangle
+	const SpMat landmarkCols = m_landmarkMat;
+	m_AtA.resize(nTotalVerts, nTotalVerts);
+	for (int pass = 0; pass < 2; pass++)
+	{
+		if (pass == 1)
+		{
+			for (int j = 0; j < nTotalVerts; j++)
+				m_AtA.outerIndexPtr()[j + 1] += m_AtA.outerIndexPtr()[j];
+			m_AtA.resizeNonZeros(m_AtA.outerIndexPtr()[nTotalVerts]);
+		}
+#pragma omp parallel num_threads(getNumThreads())
+		{
+			std::vector<int> rows;
+#pragma omp for schedule(static)
+			for (int j = 0; j < nTotalVerts; j++)
+			{
+				rows.clear();
+				rows.push_back(j);
+				for (int p = m_unknownFaceStart[j]; p < m_unknownFaceStart[j + 1]; p++)
+				{
+					const int* ids = faceIds(m_unknownFaces[p]);
+					for (int x = 0; x < nPoints; x++)
+					{
+						if (ids[x] > j)
+							rows.push_back(ids[x]);
+					}
+				}
+				for (SpMat::InnerIterator it(landmarkCols, j); it; ++it)
+				{
+					for (SpMatR::InnerIterator it_l(m_landmarkMat, it.index()); it_l; ++it_l)
+					{
+						if (it_l.index() > j)
+							rows.push_back((int)it_l.index());
+					}
+				}
+				std::sort(rows.begin(), rows.end());
+				rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+				if (pass == 0)
+					m_AtA.outerIndexPtr()[j + 1] = (int)rows.size();
+				else
+					std::copy(rows.begin(), rows.end(), m_AtA.innerIndexPtr() + m_AtA.outerIndexPtr()[j]);
+			}
+		}
+	}
+
+	// positions of the per-face block entries
+	m_facePairPos.resize(nFaces * nPairs);
+#pragma omp parallel for num_threads(getNumThreads()) schedule(static)
+	for (int iFace = 0; iFace < nFaces; iFace++)
+	{
+		const int* ids = faceIds(iFace);
+		for (int a = 0; a < nPoints; a++)
+			for (int b = 0; b <= a; b++)
+				m_facePairPos[iFace * nPairs + lowerPairIndex(a, b)] = findLowerEntry(m_AtA, ids[a], ids[b]);
+	}
+}
+
+// AtA += w * C^T * C, the pairs of each row are in the pattern of AtA
+static void addConstraintAtA(MeshTransfer::SpMat& AtA, const MeshTransfer::SpMatR& C, real w)
+{
+	for (int r = 0; r < C.rows(); r++)
+	{
+		for (MeshTransfer::SpMatR::InnerIterator it_a(C, r); it_a; ++it_a)
+		{
+			for (MeshTransfer::SpMatR::InnerIterator it_b(C, r); it_b && it_b.index() <= it_a.index(); ++it_b)
+				AtA.valuePtr()[findLowerEntry(AtA, it_a.index(), it_b.index())] += w * it_a.value() * it_b.value();
+		}
+	}
+}
+
+void MeshTransfer::setup_AtA()
+{
+	setup_AtA(nullptr, m_w, m_AtA);
+}
+
+void MeshTransfer::setup_AtA(const real* faceWeights, const Weights& weights, SpMat& AtA)const
+{
+	// AtA has the pattern of m_AtA, thus the positions of m_facePairPos
+	const int nTotalVerts = getNumUnknowns();
+	const int nPoints = getNumFacePoints();
+	const int nPairs = lowerPairIndex(nPoints, 0);
+	real* values = AtA.valuePtr();
+	std::fill(values, values + AtA.nonZeros(), real(0));
+
+	// E1: each face adds w1 * A^T * A (times its emphasis weight) to the pairs of its unknowns,
+	// faces of the same color touch disjoint entries thus can be scattered in parallel
+	for (size_t iColor = 0; iColor + 1 < m_colorFaceStart.size(); iColor++)
+	{
+#pragma omp parallel for num_threads(getNumThreads()) schedule(static)
+		for (int p = m_colorFaceStart[iColor]; p < m_colorFaceStart[iColor + 1]; p++)
+		{
+			const int iFace = m_colorFaces[p];
+			const real* A = m_E1Mat.valuePtr() + iFace * 3 * nPoints;
+			const int* pairPos = m_facePairPos.data() + iFace * nPairs;
+			const real w = faceWeights ? weights.correspond * faceWeights[iFace] : weights.correspond;
+			for (int a = 0; a < nPoints; a++)
+			{
+				for (int b = 0; b <= a; b++)
+				{
+					real AtA_ab = 0;
+					for (int y = 0; y < 3; y++)
+						AtA_ab += A[y * nPoints + a] * A[y * nPoints + b];
+					values[pairPos[lowerPairIndex(a, b)]] += w * AtA_ab;
+				}
+			}
+		}
+	}
+
+	// anchors and landmarks: each row adds w * row^T * row
+	addConstraintAtA(AtA, m_ancorMat, weights.anchor);
+	addConstraintAtA(AtA, m_landmarkMat, weights.landmark);
+
+	// isolated-point regularization: identity, the diagonal is the first entry of each column
+	for (int j = 0; j < nTotalVerts; j++)
+		values[AtA.outerIndexPtr()[j]] += weights.regularization;
+}
+
+bool MeshTransfer::updateTargetVertices(const std::vector<int>& vertIds, const std::vector<Float3>& positions)
+{
+	if (!m_bInit)
+	{
+		m_errStr = "not initialized when calling updateTargetVertices()";
+		return false;
+	}
+	if (vertIds.size() != positions.size())
+	{
+		m_errStr = "updateTargetVertices: ids and positions not matched!";
+		return false;
+	}
+	const int nMeshVerts = (int)m_tarVerts0.size();
+	for (size_t i = 0; i < vertIds.size(); i++)
+	{
+		if (vertIds[i] < 0 || vertIds[i] >= nMeshVerts)
+		{
+			m_errStr = "updateTargetVertices: vertex index out of range!";
+			return false;
+		}
+	}
+	if (hasIllegalData((const float*)positions.data(), (int)positions.size() * 3))
+	{
+		m_errStr = "nan or inf in input positions";
+		return false;
+	}
+	if (vertIds.empty())
+		return true;
+
+	// the faces around the moved vertices
+	const int nFaces = (int)m_facesTri.size();
+	const int nPoints = getNumFacePoints();
+	std::vector<char> isAffected(nFaces, 0);
+	std::vector<int> faces;
+	for (size_t i = 0; i < vertIds.size(); i++)
+	{
+		m_tarVerts0[vertIds[i]] = positions[i];
+		for (int p = m_unknownFaceStart[vertIds[i]]; p < m_unknownFaceStart[vertIds[i] + 1]; p++)
+		{
+			if (!isAffected[m_unknownFaces[p]])
+			{
+				isAffected[m_unknownFaces[p]] = 1;
+				faces.push_back(m_unknownFaces[p]);
+			}
+		}
+	}
+	clear_blendshapeBasis();
+	modelChanged();
+
+	// their E1 rows, keeping the old ones to patch AtA
+	const int nFaceValues = 3 * nPoints;
+	std::vector<real> oldE1(faces.size() * nFaceValues);
+	for (size_t f = 0; f < faces.size(); f++)
+		std::copy_n(m_E1Mat.valuePtr() + faces[f] * nFaceValues, nFaceValues, oldE1.data() + f * nFaceValues);
+	for (size_t f0 = 0; f0 < faces.size(); f0 += FACE_LANES)
+		setup_E1Faces(faces.data() + f0, std::min((int)FACE_LANES, int(faces.size() - f0)), m_tarVerts0);
+	if (hasIllegalData(m_E1Mat.valuePtr(), (int)m_E1Mat.nonZeros()))
+	{
+		m_errStr = "nan or inf in E1Mat!";
+		m_bInit = false;
+		return false;
+	}
+
+	// B0 is also the rhs of the regularization, the anchors and the landmarks
+	setup_RegularizationRhs(m_tarVerts0);
+	setup_ancorRhs(m_tarVerts0);
+	setup_landmarkRhs(m_tarVerts0);
+	setup_constantAtb(m_w, m_anchorRegSumAtb);
+
+	if (m_solverType == SolverMatrixFreePCG)
+	{
+		setup_pcgPreconditioner();
+		return true;
+	}
+
+	// the float factor and the preconditioners are computed again from the whole AtA
+	if (m_solverType != SolverCholesky || (m_precision == PrecisionFloat && !m_gradientEmphasis))
+	{
+		setup_AtA();
+		if (!factorize())
+		{
+			m_bInit = false;
+			return false;
+		}
+		return true;
+	}
+
+	// patch AtA by w1 * (A^T * A - A_old^T * A_old) of each face, only the entries among its unknowns change
+	const int nPairs = lowerPairIndex(nPoints, 0);
+	std::vector<int> changed;
+	for (size_t f = 0; f < faces.size(); f++)
+	{
+		const int iFace = faces[f];
+		const real* A = m_E1Mat.valuePtr() + iFace * nFaceValues;
+		const real* A0 = oldE1.data() + f * nFaceValues;
+		const int* pairPos = m_facePairPos.data() + iFace * nPairs;
+		for (int a = 0; a < nPoints; a++)
+		{
+			for (int b = 0; b <= a; b++)
+			{
+				real AtA_ab = 0;
+				for (int y = 0; y < 3; y++)
+					AtA_ab += A[y * nPoints + a] * A[y * nPoints + b] - A0[y * nPoints + a] * A0[y * nPoints + b];
+				m_AtA.valuePtr()[pairPos[lowerPairIndex(a, b)]] += m_w.correspond * AtA_ab;
+			}
+			changed.push_back(m_E1Mat.innerIndexPtr()[iFace * nFaceValues + a]);
+		}
+	}
+
+	// a zero pivot on the paths, factor again from AtA
+	if (m_solver.refactorize(m_AtA, changed) != Eigen::Success)
+	{
+		if (!factorize())
+		{
+			m_bInit = false;
+			return false;
+		}
+	}
+	return true;
+}
+
+void MeshTransfer::setup_RegularizationRhs(const std::vector<Float3>& tarVerts0)
+{
+	const int nMeshVerts = (int)m_srcVerts0.size();
+	const int nTotalVerts = getNumUnknowns();
+	m_regAtb.resize(nTotalVerts, 3);
+	m_regAtb.setZero();
+	for (int iVert = 0; iVert < nMeshVerts; iVert++)
+	{
+		for (int k = 0; k < 3; k++)
+			m_regAtb(iVert, k) = tarVerts0[iVert][k];
+	}
+}
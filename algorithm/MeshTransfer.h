@@ -1,76 +1,374 @@
-#pragma once
-#include <vector>
-#include <Eigen/Dense>
-#include <Eigen/Sparse>
-
-// Deformation Transfer
-// Input:
-//	A0, A1, ..., An
-//  B0
-// Output:
-//	  , B1, ..., Bn
-// Where Ai, Bi are triangle meshes with the same topology
-//	i.e., same faces and the same number of vertices.
-
-/// TODO: we should manually specify anchor points, instead of just fixing the 0th vertices.
-
-class MeshTransfer
-{
-public:
-	typedef double real;
-	typedef Eigen::Matrix<real, -1, 1> Vec;
-	typedef Eigen::Matrix<real, -1, -1> Mat;
-	typedef Eigen::SparseMatrix<real, Eigen::ColMajor> SpMat;
-	typedef Eigen::Vector3f Float3;
-	typedef Eigen::Matrix3f Mat3f;
-	typedef Eigen::Vector3i Int3;
-	typedef Eigen::Vector4i Int4;
-public:
-	MeshTransfer() {}
-	~MeshTransfer() {}
-
-	// Initialize the topology and 0th reference mesh A0
-	bool init(int nTriangles, const Int3* pTriangles, int nVertices, 
-		const Float3* pSrcVertices0, const Float3* pTarVertices0);
-
-	// Given B0, Ai, output Bi
-	bool transfer(const std::vector<Float3>& srcVerts1, std::vector<Float3>& tarVerts1);
-
-	const char* getErrString()const;
-protected:
-	void clear();
-	void findAnchorPoints();
-
-	void setup_E1Mat(const std::vector<Float3>& tarVerts0);
-	void setup_E1Rhs(const std::vector<Float3>& srcVertsDeformed);
-	void setup_ancorMat();
-	void setup_ancorRhs(const std::vector<Float3>& tarVerts0);
-	void setup_RegularizationMat();
-	void setup_RegularizationRhs(const std::vector<Float3>& tarVerts0);
-
-	void vertex_vec_to_point(const Vec& x, std::vector<Float3>& verts)const;
-	void vertex_point_to_vec(Vec& x, const std::vector<Float3>& verts, const std::vector<Int3>& faces)const;
-private:
-	bool m_bInit = false;
-	std::vector<Int3> m_facesTri;		// triangles converted from src mesh
-	std::vector<int> m_anchors;			// index of all anchor points
-	std::vector<Float3> m_srcVerts0;
-	std::vector<Float3> m_tarVerts0;
-	std::string m_errStr;
-
-	// energy related
-	SpMat m_E1Mat, m_E1MatT;			// the energy for src-tar triangle correspondences
-	Vec m_E1Rhs;						// the energy for src-tar triangle correspondences
-
-	SpMat m_ancorMat;					// for anchor points
-	SpMat m_ancorMatT;					// for anchor points
-	Vec m_ancorRhs;						// for anchor points
-	SpMat m_regAtA;						// for isolated-point regularization
-	Vec m_regAtb;						// for isolated-point regularization
-	Vec m_anchorRegSumAtb;				// m_ancorMatT * m_ancorRhs * w_anchor + m_regAtb * w_reg
-
-	SpMat m_AtA;						// the total energy matrix
-	Vec m_Atb, m_x;						// the total right-hand-side value and the solved result
-	Eigen::SimplicialCholesky<SpMat> m_solver;
-	bool m_shouldAnalysisTopology = false;
-};
+#pragma once
+#include <vector>
+#include <string>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include "CholeskyFactor.h"
+#include "MultigridPreconditioner.h"
+#include "SupernodalCholesky.h"
+
+// Deformation Transfer
+// Input:
+//	A0, A1, ..., An
+//  B0
+// Output:
+//	  , B1, ..., Bn
+// Where Ai, Bi are triangle meshes with the same topology
+//	i.e., same faces and the same number of vertices.
+
+// By default only the 0th vertex is anchored, more can be pinned by addAnchors().
+
+// The x/y/z coordinates are decoupled in the energy, so only one scalar system over the
+// unknown vertices is assembled and factored; the three coordinates are solved
+// together as the columns of a dense n x 3 right-hand side.
+
+class MeshTransfer
+{
+public:
+	typedef double real;
+	typedef Eigen::Matrix<real, -1, 1> Vec;
+	typedef Eigen::Matrix<real, -1, -1> Mat;
+	typedef Eigen::Matrix<real, -1, -1, Eigen::RowMajor> MatR;
+	typedef Eigen::SparseMatrix<real, Eigen::ColMajor> SpMat;
+	typedef Eigen::SparseMatrix<real, Eigen::RowMajor> SpMatR;
+	typedef Eigen::SparseMatrix<float, Eigen::ColMajor> SpMatf;
+	typedef Eigen::Vector3f Float3;
+	typedef Eigen::Vector4f Float4;
+	typedef Eigen::Matrix3f Mat3f;
+	typedef Eigen::Vector3i Int3;
+	typedef Eigen::Vector4i Int4;
+
+	// How the deformation gradients of the target triangles are formulated
+	enum Formulation
+	{
+		// each triangle gets an auxiliary 4th vertex along its normal, 
+		// the unknowns are nVertices + nTriangles
+		FormulationAuxNormalVertex,
+		// the gradient is only defined in the triangle plane via the pseudo-inverse of the edge matrix,
+		// the unknowns are nVertices
+		FormulationVertexOnly,
+	};
+
+	// The precision of the factor and triangular solves
+	enum Precision
+	{
+		PrecisionDouble,
+		// the factor takes half the memory and bandwidth, 
+		// the double accuracy is recovered by iterative refinement against the double AtA,
+		// the transfer fails if the refinement does not converge
+		PrecisionFloat,
+	};
+
+	// How the normal equations are solved
+	enum SolverType
+	{
+		// sparse Cholesky factor of AtA, factored and solved in parallel over the subtrees of the elimination tree
+		SolverCholesky,
+		// Jacobi-preconditioned conjugate gradient, AtA is applied on the fly from the per-face operators
+		// and never formed, thus the memory is linear in the number of faces
+		SolverMatrixFreePCG,
+		// preconditioned CG on AtA (see PreconditionerType), started from the solutions of the previous frames
+		// in the workspace, cheap for coherent animation sequences
+		SolverWarmStartPCG,
+		// supernodal sparse LL^T of AtA on dense blocked kernels, faster factorization and solves on large meshes,
+		// factored in parallel over the subtrees of the elimination tree.
+		// The factor is not modified in place: anchor and B0 edits factor it again, transferIncremental() does
+		// full transfers, and the gradient emphasis and sweepWeights() are not supported
+		SolverSupernodalCholesky,
+	};
+
+	// The preconditioner of SolverWarmStartPCG
+	enum PreconditionerType
+	{
+		PreconditionerIncompleteCholesky,
+		// smoothed-aggregation multigrid, the iteration counts barely grow with the mesh size
+		PreconditionerMultigrid,
+	};
+
+	// A point on the target mesh, the barycentric combination of up to 4 vertices, e.g. of a quad face,
+	// unused vertices have zero weights
+	struct Landmark
+	{
+		Int4 verts;
+		Float4 weights;
+	};
+
+	// The energy weights, see ParameterConfig.h for the defaults.
+	// Each term is divided by its number of constraints when applied.
+	struct Weights
+	{
+		real correspond;
+		real anchor;
+		real landmark;
+		real regularization;	// must be positive
+		real emphasisKappa;		// for the gradient emphasis
+		real emphasisTheta;
+		Weights();
+	};
+
+	// The per-call state of transfer(). After init()/setTarget() the model is read-only,
+	// thus several threads may run the const transfer() concurrently, each with its own Workspace.
+	struct Workspace
+	{
+		Mat Atb, x;						// the total right-hand-side value and the solved result, 3 columns per frame
+		Eigen::Matrix<real, -1, -1, Eigen::RowMajor> solveBuffer;	// row-major, all frames of a row are contiguous
+		Mat r;							// the residual Atb - AtA * x
+		Eigen::MatrixXf bf, xf;			// for the float precision mode
+		Eigen::Matrix<float, -1, -1, Eigen::RowMajor> solveBufferf;
+		real residual = 0;				// the max relative residual over all columns of the last solve
+		bool hasResidual = true;		// false when the last solve did not measure it, see getResidual()
+		int nRefinements = 0;			// number of refinement steps of the last solve
+		int nIterations = 0;			// number of PCG iterations of the last solve, summed over the frames solved one by one
+		MatR pcg_x, pcg_r, pcg_z, pcg_p, pcg_q;	// for SolverMatrixFreePCG
+		Mat xHistory[2];				// for SolverWarmStartPCG, the results of the last two frames, [1] is the latest
+		int nHistory = 0;				// set to 0 to restart a sequence
+		unsigned modelVersion = 0;		// the model version the history and the incremental state belong to
+		std::vector<real> faceWeights;	// for the gradient emphasis, the per-face weights of the current frame
+		SpMat AtA;						// for the gradient emphasis and sweepWeights(), AtA of this workspace and its factor
+		CholeskyFactor<SpMat> solver;
+		bool hasIncremental = false;	// for transferIncremental(), set to false to restart
+		std::vector<Float3> incSrcVerts;	// the src, its per-face gradients and the result the next frame is relative to
+		std::vector<real> incGradients;
+		Mat incX;
+		MatR incB, incDx, incBuffer;
+		int nChangedFaces = 0;			// the faces in the delta rhs of the last transferIncremental()
+		bool ownWeights = false;		// for sweepWeights(), the normalized weights and constant rhs below replace the model ones
+		Weights weights;
+		Mat constantAtb;
+		std::string errStr;
+	};
+public:
+	MeshTransfer() {}
+	~MeshTransfer() {}
+
+	// The modes below take effect at the next init(), the model is built for them. Changing one of them
+	// uninitializes the model until then, thus transfer() fails instead of mixing two configurations.
+	void setFormulation(Formulation f) { m_bInit = m_bInit && f == m_formulation; m_formulation = f; }
+	Formulation getFormulation()const { return m_formulation; }
+
+	void setPrecision(Precision p) { m_bInit = m_bInit && p == m_precision; m_precision = p; }
+	Precision getPrecision()const { return m_precision; }
+
+	// the precision is not used by SolverMatrixFreePCG
+	void setSolverType(SolverType t) { m_bInit = m_bInit && t == m_solverType; m_solverType = t; }
+	SolverType getSolverType()const { return m_solverType; }
+
+	// Li Hao's per-face gradient emphasis, see ParameterConfig.h, a mode as above.
+	// The weights depend on each src frame, thus AtA is refilled and numerically refactored per frame
+	// in the workspace, reusing the pattern and symbolic analysis of init().
+	// Only for SolverCholesky, always in double precision.
+	void setGradientEmphasis(bool enable) { m_bInit = m_bInit && enable == m_gradientEmphasis; m_gradientEmphasis = enable; }
+	bool getGradientEmphasis()const { return m_gradientEmphasis; }
+
+	// PCG stops when the Jacobi-scaled relative residual of every column is below tol, or after maxIterations.
+	// tol < 0 is the default of the solver type, see ParameterConfig.h
+	void setPCGParameters(real tol, int maxIterations) { m_pcgTolerance = tol; m_pcgMaxIterations = maxIterations; }
+
+	// a mode as above
+	void setPreconditioner(PreconditionerType t) { m_bInit = m_bInit && t == m_preconditioner; m_preconditioner = t; }
+	PreconditionerType getPreconditioner()const { return m_preconditioner; }
+
+	// for SolverWarmStartPCG, start from the linear extrapolation of the last two frames instead of the last one
+	void setWarmStartExtrapolation(bool enable) { m_warmStartExtrapolation = enable; }
+
+	// forget the previous frames of the non-const transfer()/transferIncremental(), e.g. when a new sequence starts,
+	// a Workspace forgets them by itself when the model changed since, see Workspace::modelVersion
+	void resetWarmStart() { m_workspace.nHistory = 0; m_workspace.hasIncremental = false; }
+
+	// number of threads for the per-face computations and the Cholesky factorizations and solves,
+	// 0 means the OpenMP default
+	// the results are identical for any number of threads, except up to rounding for SolverSupernodalCholesky
+	void setNumThreads(int nThreads) { m_nThreads = nThreads; }
+	int getNumThreads()const;
+
+	// Initialize the topology and 0th reference mesh A0
+	bool init(int nTriangles, const Int3* pTriangles, int nVertices, 
+		const Float3* pSrcVertices0, const Float3* pTarVertices0, const Weights& weights = Weights());
+
+	// Replace the energy weights, the symbolic analysis of init() is reused, only the numeric factorization is redone.
+	bool setWeights(const Weights& weights);
+	const Weights& getWeights()const { return m_weights; }
+
+	// Transfer the probe frames srcVerts1 under each of the weight settings, into tarVerts1[iSetting][iFrame].
+	// The settings run in parallel on nThreads threads (0 means the OpenMP default), each thread refills and
+	// numerically factors its own AtA, sharing the pattern and symbolic analysis of init(). Only for SolverCholesky.
+	bool sweepWeights(const std::vector<Weights>& settings, const std::vector<std::vector<Float3>>& srcVerts1,
+		std::vector<std::vector<std::vector<Float3>>>& tarVerts1, int nThreads = 0);
+
+	// Replace B0 by another target rest mesh of the same topology, 
+	// the sparsity pattern and symbolic analysis of init() are reused, only the numeric factorization is redone.
+	bool setTarget(const std::vector<Float3>& tarVerts0);
+
+	// Move some vertices of B0, e.g. after a local sculpt. Only the E1 rows of the faces around them are recomputed
+	// and patched into AtA, and with SolverCholesky in double precision only the rows of the factor on the
+	// elimination-tree paths from their unknowns are factored again; the other solvers are set up as by setTarget().
+	bool updateTargetVertices(const std::vector<int>& vertIds, const std::vector<Float3>& positions);
+
+	// Pin more vertices to their B0 positions, or release pinned ones; ids already in that state are ignored.
+	// The anchor weight is normalized again by the new number of anchors, as in init(). With SolverCholesky in
+	// double precision only the rows of the factor on the elimination-tree paths from the anchors are factored
+	// again, the other solvers are set up as by setTarget().
+	bool addAnchors(const std::vector<int>& vertIds);
+	bool removeAnchors(const std::vector<int>& vertIds);
+	const std::vector<int>& getAnchors()const { return m_anchors; }
+
+	// Soft landmark constraints, they are folded into AtA, thus take effect at the next init().
+	// Their targets are their positions on B0 after init()/setTarget().
+	void setLandmarks(const std::vector<Landmark>& landmarks) { m_landmarks = landmarks; }
+	const std::vector<Landmark>& getLandmarks()const { return m_landmarks; }
+
+	// Move the landmarks to new targets, e.g. per frame, only the right-hand side changes.
+	// Do not call it concurrently with the const transfer().
+	bool setLandmarkTargets(const std::vector<Float3>& targets);
+
+	// Given B0, Ai, output Bi
+	bool transfer(const std::vector<Float3>& srcVerts1, std::vector<Float3>& tarVerts1);
+	bool transfer(const std::vector<Float3>& srcVerts1, std::vector<Float3>& tarVerts1, Workspace& ws)const;
+
+	// Given B0, A1, ..., AK, output B1, ..., BK
+	// all the frames share one pass over the factor, which is much cheaper than K transfer() calls.
+	bool transferBatch(const std::vector<std::vector<Float3>>& srcVerts1, 
+		std::vector<std::vector<Float3>>& tarVerts1);
+	bool transferBatch(const std::vector<std::vector<Float3>>& srcVerts1,
+		std::vector<std::vector<Float3>>& tarVerts1, Workspace& ws)const;
+
+	// Incremental transfer for coherent frames that only move locally, e.g. the mouth in a lipsync clip.
+	// The faces whose src gradients changed by more than tol since the last frame of the workspace give a sparse
+	// delta rhs, whose forward substitution only runs over its elimination-tree reach, and the solved delta is added
+	// to the last result. Changes below tol are deferred until they exceed it.
+	// The first frame is a full transfer, set Workspace::hasIncremental = false to restart a sequence; it also
+	// restarts after any change of the model, e.g. setTarget(), setWeights() or addAnchors().
+	// Only for SolverCholesky in double precision without the gradient emphasis, otherwise a full transfer.
+	bool transferIncremental(const std::vector<Float3>& srcVerts1, std::vector<Float3>& tarVerts1, real tol = 0);
+	bool transferIncremental(const std::vector<Float3>& srcVerts1, std::vector<Float3>& tarVerts1, real tol,
+		Workspace& ws)const;
+
+	// Blendshape basis mode: A1, ..., AK are transferred once, in one transferBatch(), and the deltas Bk - B0'
+	// are kept as a dense basis, B0' being the transfer of A0. The combination A0 + sum_k w_k * (Ak - A0)
+	// is then transferred by one GEMV. The normalized 4th vertices make the transfer slightly nonlinear in w,
+	// with corrective = true the combined src is solved exactly instead, at the cost of a transfer().
+	// The basis is dropped by init(), setTarget(), updateTargetVertices(), setWeights(), setLandmarkTargets()
+	// and anchor edits.
+	bool setBlendshapeBasis(const std::vector<std::vector<Float3>>& srcShapes);
+	int getNumBlendshapes()const { return (int)m_basisDelta.cols(); }
+	bool evalBlendshapes(const std::vector<float>& weights, std::vector<Float3>& tarVerts, bool corrective = false);
+	bool evalBlendshapes(const std::vector<float>& weights, std::vector<Float3>& tarVerts, bool corrective,
+		Workspace& ws)const;
+
+	const char* getErrString()const;
+
+	// the residual and refinement steps of the last non-const transfer()/transferBatch()
+	// the direct double precision solves do not measure the residual, it is then computed on the first query
+	real getResidual() { return getResidual(m_workspace); }
+	real getResidual(Workspace& ws)const;
+	int getNumRefinements()const { return m_workspace.nRefinements; }
+	int getNumIterations()const { return m_workspace.nIterations; }
+	// the faces in the delta rhs of the last non-const transferIncremental()
+	int getNumChangedFaces()const { return m_workspace.nChangedFaces; }
+protected:
+	void clear();
+	void findAnchorPoints();
+	int getNumUnknowns()const;
+	int getNumFacePoints()const;
+	bool checkSrcVertsDeformed(const std::vector<Float3>& srcVertsDeformed, Workspace& ws)const;
+	void setup_Atb(const std::vector<Float3>& srcVertsDeformed, int iFrame, Workspace& ws)const;
+	bool solve(Workspace& ws)const;
+	void solve_float(const Mat& b, Mat& x, Workspace& ws)const;
+	real residual(Workspace& ws)const;
+	void setup_equilibrate();
+	Eigen::ComputationInfo factorize_float();
+	Eigen::ComputationInfo factorize_preconditioner();
+	void solve_warmStart(Workspace& ws)const;
+	void solve_pcg(Workspace& ws)const;
+	void apply_AtA(const MatR& x, MatR& y)const;
+	void setup_pcgPreconditioner();
+	bool setup_target();
+	bool factorize();
+	bool update_anchors(const std::vector<int>& vertIds, bool add);
+	void clear_blendshapeBasis();
+	void modelChanged();
+	void checkModelVersion(Workspace& ws)const;
+
+	void setup_E1Mat(const std::vector<Float3>& tarVerts0);
+	void setup_E1Faces(const int* iFaces, int nLanes, const std::vector<Float3>& tarVerts0);
+	void setup_srcOperators(const std::vector<Float3>& srcVerts0);
+	void setup_E1Atb(const std::vector<Float3>& srcVertsDeformed, int iFrame, Workspace& ws)const;
+	void setup_E1Atb_parallel(const std::vector<Float3>& srcVertsDeformed, int iFrame, Workspace& ws)const;
+	void setup_ancorMat();
+	void setup_ancorRhs(const std::vector<Float3>& tarVerts0);
+	void setup_landmarkMat();
+	void setup_landmarkRhs(const std::vector<Float3>& tarVerts0);
+	void setup_constantAtb(const Weights& w, Mat& Atb)const;
+	Weights normalizeWeights(const Weights& weights)const;
+	const Weights& activeWeights(const Workspace& ws)const { return ws.ownWeights ? ws.weights : m_w; }
+	real pcgTolerance()const;
+	bool usesWorkspaceFactor(const Workspace& ws)const { return m_gradientEmphasis || ws.ownWeights; }
+	void setup_faceColoring();
+	void setup_AtAPattern();
+	void setup_AtA();
+	void setup_AtA(const real* faceWeights, const Weights& w, SpMat& AtA)const;
+	bool factorize_workspace(Workspace& ws)const;
+	void setup_RegularizationRhs(const std::vector<Float3>& tarVerts0);
+
+	void vertex_vec_to_point(const Eigen::Ref<const Mat>& x, std::vector<Float3>& verts)const;
+	void vertex_point_to_vec(Mat& x, const std::vector<Float3>& verts, const std::vector<Int3>& faces)const;
+private:
+	bool m_bInit = false;
+	unsigned m_modelVersion = 0;		// bumped on every change of the model, see Workspace::modelVersion
+	Formulation m_formulation = FormulationAuxNormalVertex;
+	Precision m_precision = PrecisionDouble;
+	SolverType m_solverType = SolverCholesky;
+	PreconditionerType m_preconditioner = PreconditionerIncompleteCholesky;
+	real m_pcgTolerance = -1;			// < 0 for the default of the solver type, see pcgTolerance()
+	int m_pcgMaxIterations = 5000;
+	bool m_warmStartExtrapolation = true;
+	int m_nThreads = 0;
+	bool m_gradientEmphasis = false;
+	std::vector<Int3> m_facesTri;		// triangles converted from src mesh
+	std::vector<int> m_anchors;			// index of all anchor points
+	std::vector<Landmark> m_landmarks;
+	std::vector<Float3> m_srcVerts0;
+	std::vector<Float3> m_tarVerts0;
+	std::string m_errStr;
+
+	// energy related
+	// all matrices below are scalar blocks shared by x/y/z, all rhs/results have 3 columns
+	// the rows of E1 and anchors have a known number of nonzeros, thus they are filled in compressed
+	// row-major storage directly; their transposes are just column-major views of the same storage.
+	SpMatR m_E1Mat;						// the energy for src-tar triangle correspondences
+	std::vector<float> m_srcOpA;		// per-face 3x4 operators of A0, SoA: (y,x) of face i at [(y*4+x)*nFaces+i]
+	std::vector<char> m_srcFaceInvalid;	// per-face flags of degenerated A0 triangles
+
+	SpMatR m_ancorMat;					// for anchor points
+	Mat m_ancorRhs;						// for anchor points
+	SpMatR m_landmarkMat;				// for landmarks, one barycentric row each
+	Mat m_landmarkRhs;
+	Mat m_regAtb;						// for isolated-point regularization
+	Mat m_anchorRegSumAtb;				// the right-hand side of anchors, landmarks and regularization, C^T * rhs * w
+	Weights m_weights;					// as given
+	Weights m_w;						// normalized by the number of constraints
+
+	// AtA is assembled directly from the per-face blocks w1 * A^T * A, scattered into a fixed pattern
+	SpMat m_AtA;						// the total energy matrix, lower triangular part only, S * AtA * S for SolverWarmStartPCG
+	std::vector<int> m_unknownFaceStart;// faces incident to each unknown, CSR style
+	std::vector<int> m_unknownFaces;
+	std::vector<int> m_colorFaceStart;	// faces grouped by colors, faces of the same color share no unknowns
+	std::vector<int> m_colorFaces;
+	std::vector<int> m_facePairPos;		// for each face, the positions in m_AtA of its lower-triangular pairs
+	Workspace m_workspace;				// for the non-const transfer()
+	CholeskyFactor<SpMat> m_solver;		// for PrecisionDouble
+	Vec m_equilibrate;					// for PrecisionFloat and SolverWarmStartPCG, S = diag(AtA)^(-1/2)
+	SpMatf m_AtAf;
+	CholeskyFactor<SpMatf> m_solverf;
+	SupernodalCholesky<real> m_supernodal;	// for SolverSupernodalCholesky, instead of m_solver/m_solverf
+	SupernodalCholesky<float> m_supernodalf;
+	Vec m_pcgInvDiag;					// for SolverMatrixFreePCG, the Jacobi preconditioner
+	Eigen::IncompleteCholesky<real, Eigen::Lower> m_ichol;	// for SolverWarmStartPCG, of S * AtA * S
+	MultigridPreconditioner<real> m_multigrid;
+	bool m_shouldAnalysisTopology = true;	// the symbolic analysis is needed only when the topology changed
+
+	// blendshape basis mode, 3 rows per mesh vertex
+	Eigen::VectorXf m_basisRest;		// the transfer of A0
+	Eigen::MatrixXf m_basisDelta;		// the transfer of Ak minus m_basisRest, one column per shape
+	Eigen::MatrixXf m_basisSrcDelta;	// Ak - A0, for the corrective solve
+};
@@ -0,0 +1,214 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+
+// Smoothed-aggregation algebraic multigrid, as a preconditioner of the conjugate gradient.
+// The coarse levels are aggregated from the graph of the matrix itself, which for the transfer
+// system is just the mesh connectivity (plus the auxiliary normal vertices), thus no explicit
+// mesh hierarchy is needed.
+// solve() applies one V-cycle with the same number of damped Jacobi steps before and after the
+// coarse correction, so the preconditioner is symmetric positive definite as CG requires.
+// It can be passed to Eigen::internal::conjugate_gradient() directly.
+template<class Scalar>
+class MultigridPreconditioner
+{
+public:
+	typedef Eigen::SparseMatrix<Scalar, Eigen::ColMajor> SpMat;
+	typedef Eigen::Matrix<Scalar, -1, 1> Vec;
+public:
+	MultigridPreconditioner() {}
+	~MultigridPreconditioner() {}
+
+	// the parameters take effect at the next compute()
+	void setCoarsestSize(int n) { m_coarsestSize = n; }
+	void setMaxLevels(int n) { m_maxLevels = n; }
+	// a neighbor j of i is aggregated with i when |a_ij| >= theta * sqrt(a_ii * a_jj).
+	// The transfer system is far from an M-matrix, the couplings of the deformation gradients largely cancel,
+	// thus the default 0 aggregates whole graph neighborhoods, larger thresholds barely coarsen it.
+	void setStrengthThreshold(Scalar theta) { m_theta = theta; }
+	void setNumSmoothingSteps(int n) { m_nSmoothingSteps = n; }
+
+	// A is symmetric positive definite, only its lower triangular part is read.
+	// nearNullSpace is the smooth mode the coarse levels should represent exactly,
+	// e.g. the constant vector for a Laplacian, or S^-1 * 1 for the equilibrated S * A * S.
+	void compute(const SpMat& lowerA, const Vec& nearNullSpace);
+	void compute(const SpMat& lowerA) { compute(lowerA, Vec::Ones(lowerA.rows())); }
+
+	Eigen::ComputationInfo info()const { return m_info; }
+	int getNumLevels()const { return (int)m_levels.size() + 1; }
+
+	Vec solve(const Vec& b)const
+	{
+		Vec x;
+		vcycle(0, b, x);
+		return x;
+	}
+protected:
+	struct Level
+	{
+		SpMat A;			// full symmetric matrix of this level
+		Vec invDiag;
+		Scalar omega;		// damping of Jacobi, 4 / (3 * rho(D^-1 * A))
+		SpMat P, Pt;		// prolongation to this level from the next coarser one
+	};
+	static void aggregate(const SpMat& A, const Vec& diag, Scalar theta, std::vector<int>& agg, int& nAgg);
+	void vcycle(int iLevel, const Vec& b, Vec& x)const;
+private:
+	int m_coarsestSize = 500;
+	int m_maxLevels = 20;
+	Scalar m_theta = Scalar(0);
+	int m_nSmoothingSteps = 1;
+
+	std::vector<Level> m_levels;
+	Eigen::SimplicialLDLT<SpMat> m_coarsestSolver;
+	Eigen::ComputationInfo m_info = Eigen::InvalidInput;
+};
+
+template<class Scalar>
+void MultigridPreconditioner<Scalar>::compute(const SpMat& lowerA, const Vec& nearNullSpace)
+{
+	m_levels.clear();
+	SpMat A = lowerA.template selfadjointView<Eigen::Lower>();
+	Vec B = nearNullSpace;
+	while ((int)m_levels.size() + 1 < m_maxLevels && A.rows() > m_coarsestSize)
+	{
+		const int n = (int)A.rows();
+		Level level;
+		level.A = A;
+		Vec diag = A.diagonal();
+		level.invDiag = diag.cwiseInverse();
+
+		// Gershgorin bound of the spectral radius of D^-1 * A
+		Scalar rho = 0;
+		for (int j = 0; j < n; j++)
+		{
+			Scalar sum = 0;
+			for (typename SpMat::InnerIterator it(A, j); it; ++it)
+				sum += std::abs(it.value());
+			rho = std::max(rho, sum * level.invDiag[j]);
+		}
+		level.omega = Scalar(4) / (Scalar(3) * rho);
+
+		// tentative prolongation: each aggregate gets the near null space restricted to it, normalized
+		std::vector<int> agg;
+		int nAgg = 0;
+		aggregate(A, diag, m_theta, agg, nAgg);
+		if (nAgg > n * 4 / 5)
+			break;
+		Vec Bc = Vec::Zero(nAgg);
+		for (int i = 0; i < n; i++)
+			Bc[agg[i]] += B[i] * B[i];
+		Bc = Bc.cwiseSqrt();
+		SpMat Ptent(n, nAgg);
+		std::vector<Eigen::Triplet<Scalar>> triplets;
+		triplets.reserve(n);
+		for (int i = 0; i < n; i++)
+			triplets.push_back(Eigen::Triplet<Scalar>(i, agg[i], Bc[agg[i]] > 0 ? B[i] / Bc[agg[i]] : Scalar(0)));
+		Ptent.setFromTriplets(triplets.begin(), triplets.end());
+
+		// smoothed prolongation P = (I - omega * D^-1 * A) * Ptent, and the Galerkin coarse matrix P^T * A * P
+		SpMat DAP = A * Ptent;
+		DAP = level.invDiag.asDiagonal() * DAP;
+		level.P = Ptent - level.omega * DAP;
+		level.Pt = level.P.transpose();
+		A = SpMat(level.Pt * SpMat(A * level.P));
+		B = Bc;
+		m_levels.push_back(level);
+	}
+
+	m_coarsestSolver.compute(A);
+	m_info = m_coarsestSolver.info();
+}
+
+template<class Scalar>
+void MultigridPreconditioner<Scalar>::aggregate(const SpMat& A, const Vec& diag, Scalar theta,
+	std::vector<int>& agg, int& nAgg)
+{
+	const int n = (int)A.rows();
+	auto isStrong = [&](int i, int j, Scalar v)
+	{
+		return i != j && std::abs(v) >= theta * std::sqrt(std::abs(diag[i] * diag[j]));
+	};
+	agg.assign(n, -1);
+	nAgg = 0;
+
+	// 1. nodes whose strong neighbors are all free form new aggregates together with them
+	for (int i = 0; i < n; i++)
+	{
+		if (agg[i] >= 0)
+			continue;
+		bool allFree = true;
+		for (typename SpMat::InnerIterator it(A, i); it && allFree; ++it)
+			allFree = !isStrong(it.index(), i, it.value()) || agg[it.index()] < 0;
+		if (!allFree)
+			continue;
+		agg[i] = nAgg;
+		for (typename SpMat::InnerIterator it(A, i); it; ++it)
+		{
+			if (isStrong(it.index(), i, it.value()))
+				agg[it.index()] = nAgg;
+		}
+		nAgg++;
+	}
+
+	// 2. the remaining nodes join the aggregate of their strongest aggregated neighbor
+	std::vector<int> agg1 = agg;
+	for (int i = 0; i < n; i++)
+	{
+		if (agg1[i] >= 0)
+			continue;
+		Scalar strongest = 0;
+		for (typename SpMat::InnerIterator it(A, i); it; ++it)
+		{
+			if (isStrong(it.index(), i, it.value()) && agg1[it.index()] >= 0 && std::abs(it.value()) > strongest)
+			{
+				strongest = std::abs(it.value());
+				agg[i] = agg1[it.index()];
+			}
+		}
+	}
+
+	// 3. the isolated ones are aggregates themselves
+	for (int i = 0; i < n; i++)
+	{
+		if (agg[i] < 0)
+			agg[i] = nAgg++;
+	}
+}
+
+template<class Scalar>
+void MultigridPreconditioner<Scalar>::vcycle(int iLevel, const Vec& b, Vec& x)const
+{
+	if (iLevel == (int)m_levels.size())
+	{
+		x = m_coarsestSolver.solve(b);
+		return;
+	}
+
+	const Level& level = m_levels[iLevel];
+	Vec r;
+
+	// pre-smoothing, starting from 0
+	x = level.omega * level.invDiag.cwiseProduct(b);
+	for (int i = 1; i < m_nSmoothingSteps; i++)
+	{
+		r = b - level.A * x;
+		x += level.omega * level.invDiag.cwiseProduct(r);
+	}
+
+	// coarse correction
+	r = b - level.A * x;
+	Vec xc;
+	vcycle(iLevel + 1, level.Pt * r, xc);
+	x += level.P * xc;
+
+	// post-smoothing
+	for (int i = 0; i < m_nSmoothingSteps; i++)
+	{
+		r = b - level.A * x;
+		x += level.omega * level.invDiag.cwiseProduct(r);
+	}
+}
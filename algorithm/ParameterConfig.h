@@ -1,40 +1,56 @@
-#pragma once
-
-
-/**
-* Parameters for Mesh Based Deformation Transfer
-*/
-namespace MeshTransferParameter
-{
-	// anchor points are automatically decided by the boundary points of markered components.
-#define USE_BOUNDARY_AS_ANCHOR
-
-	/**
-	* Parameters for Deformation Transfer
-	* Transfer Energy Function:
-	*	min || Ws * Es + Wi * Ei + Wc * Ec + Wa * Ea + W1 * E1 ||^2
-	*		Es: the smoothness term for the target mesh, 
-	*				ONLY for target trangle that cannot find corresponding src traingle.
-	*		Ei: the identity term for the target mesh
-	*				ONLY for target trangle that cannot find corresponding src traingle.
-	*		Ea: the anchor points energy
-	*				Now the anchor points are automatically selected via the boundaries of the markered components
-	*		E1: the correspond energy, deformation gradient related
-	* Note:
-	*	Each of the weight will be divided by the number of constraints and then applied.
-	*/
-	const static double Transfer_Weight_Smoothness = 1e-3;
-	const static double Transfer_Weight_Identity = 1e-6;
-	const static double Transfer_Weight_Correspond = 1.0;
-	const static double Transfer_Weight_Anchor = 1e8;
-	const static double Transfer_Weight_Regularization = 1e-8;
-
-	// from Li Hao's "Example-Based Facial Rigging"
-	// In transfering, the weight of each triangle is not the same:
-	// if the gradient of a triangle moves little in the src pair, 
-	// it should be emphasised to move a little in the target pair
-	// The weight is calculated via:
-	//	(1 + ||M||_F)^theta / (kappa + ||M||_F)^theta
-	const static double Transfer_Graident_Emhasis_kappa = 0.1;
-	const static double Transfer_Graident_Emhasis_theta = 2.5;
+#pragma once
+
+
+/**
+* Parameters for Mesh Based Deformation Transfer
+*/
+namespace MeshTransferParameter
+{
+	// anchor points are automatically decided by the boundary points of markered components.
+#define USE_BOUNDARY_AS_ANCHOR
+
+	/**
+	* Parameters for Deformation Transfer
+	* Transfer Energy Function:
+	*	min || Ws * Es + Wi * Ei + Wc * Ec + Wa * Ea + Wl * El + W1 * E1 ||^2
+	*		Es: the smoothness term for the target mesh, 
+	*				ONLY for target trangle that cannot find corresponding src traingle.
+	*		Ei: the identity term for the target mesh
+	*				ONLY for target trangle that cannot find corresponding src traingle.
+	*		Ea: the anchor points energy
+	*				Now the anchor points are automatically selected via the boundaries of the markered components
+	*		E1: the correspond energy, deformation gradient related
+	*		El: the soft landmark energy, barycentric points of the target mesh, e.g. from *.selection.txt
+	* Note:
+	*	Each of the weight will be divided by the number of constraints and then applied.
+	*/
+	const static double Transfer_Weight_Smoothness = 1e-3;
+	const static double Transfer_Weight_Identity = 1e-6;
+	const static double Transfer_Weight_Correspond = 1.0;
+	const static double Transfer_Weight_Anchor = 1e8;
+	const static double Transfer_Weight_Landmark = 1.0;
+	const static double Transfer_Weight_Regularization = 1e-8;
+
+	// from Li Hao's "Example-Based Facial Rigging"
+	// In transfering, the weight of each triangle is not the same:
+	// if the gradient of a triangle moves little in the src pair, 
+	// it should be emphasised to move a little in the target pair
+	// The weight is calculated via:
+	//	(1 + ||M||_F)^theta / (kappa + ||M||_F)^theta
+	// where M is the src deformation gradient minus identity, enabled by MeshTransfer::setGradientEmphasis()
+	const static double Transfer_Graident_Emhasis_kappa = 0.1;
+	const static double Transfer_Graident_Emhasis_theta = 2.5;
+
+	// In the float precision mode, AtA is factored in float32 and the solution is refined in double:
+	//	x += solve_float(Atb - AtA * x)
+	// until the relative correction ||dx|| / ||x|| of every column is below the tolerance.
+	// AtA is ill-conditioned by the anchor weight, thus a small residual alone does not mean a converged x.
+	const static int Transfer_Refinement_MaxIterations = 10;
+	const static double Transfer_Refinement_Tolerance = 1e-10;
+
+	// The default tolerances of the relative residual ||b - AtA * x|| / ||b|| of the iterative solvers.
+	// A warm start begins close to the previous frame, its remaining error is in the smooth modes of AtA,
+	// which hardly show in the residual, thus it needs a tighter tolerance for the same accuracy.
+	const static double Transfer_PCG_Tolerance = 1e-10;
+	const static double Transfer_WarmStart_Tolerance = 1e-14;
 };
\ No newline at end of file
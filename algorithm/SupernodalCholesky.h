@@ -0,0 +1,681 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <Eigen/OrderingMethods>
+#include "EliminationTree.h"
+
+// Supernodal sparse LL^T of a symmetric positive definite matrix, of which only the lower triangular part is read.
+// Columns of L with the same row structure below the diagonal (relaxed by a few explicit zeros) are grouped as
+// supernodes, each stored as one dense column-major block. The factorization is left-looking: each supernode
+// gathers the updates of its descendants as dense products, and the solves go block by block, thus the inner loops
+// are Eigen's blocked dense kernels (GEBP, the triangular and the selfadjoint ones) instead of scalar sparse loops.
+// The fill-reducing ordering is AMD followed by a postorder of the elimination tree,
+// so that the columns of each supernode are contiguous.
+// With several threads (OpenMP), the independent subtrees of the elimination tree are factored concurrently,
+// and the large supernodes near the root, where the tree runs out of branches, by blocks of rows.
+template<class Scalar>
+class SupernodalCholesky
+{
+public:
+	typedef Eigen::SparseMatrix<Scalar, Eigen::ColMajor> SpMat;
+	typedef Eigen::Matrix<Scalar, -1, -1> DenseMat;
+	typedef Eigen::Matrix<Scalar, -1, -1, Eigen::RowMajor> DenseMatR;
+	typedef Eigen::Map<DenseMat> BlockMap;
+	typedef Eigen::Map<const DenseMat> ConstBlockMap;
+	// the dense kernels are used from this many columns of a supernode
+	enum { SMALL_COLS = 8 };
+	// with several threads, the supernodes near the root from this many rows are factored by row blocks in parallel
+	enum { PARALLEL_ROWS = 256 };
+public:
+	SupernodalCholesky() {}
+	~SupernodalCholesky() {}
+
+	// the threads of factorize(), 1 is the plain left-looking order
+	void setNumThreads(int n) { m_nThreads = std::max(1, n); }
+	int getNumThreads()const { return m_nThreads; }
+
+	// ordering and symbolic factorization, for all matrices of the pattern of lowerA
+	void analyzePattern(const SpMat& lowerA);
+	// numeric factorization of a matrix of the analyzed pattern
+	void factorize(const SpMat& lowerA);
+	void compute(const SpMat& lowerA)
+	{
+		analyzePattern(lowerA);
+		factorize(lowerA);
+	}
+
+	Eigen::ComputationInfo info()const { return m_info; }
+	int rows()const { return (int)m_perm.size(); }
+	int getNumSupernodes()const { return (int)m_superStart.size() - 1; }
+	size_t getNumStoredEntries()const { return m_values.size(); }
+
+	// A * X = B for all columns of B in one pass over the factor, Y is the n x c buffer of the permuted system
+	void solve(const DenseMat& B, DenseMatR& Y, DenseMat& X)const;
+protected:
+	// the rows [p0, p1) of descendant d fall into the columns of the supernode it updates
+	struct Update
+	{
+		int d, p0, p1;
+	};
+	// per thread
+	struct Workspace
+	{
+		std::vector<Scalar> update;
+		std::vector<int> rel;
+	};
+	void symbolic(const SpMat& upperAp);
+	void relaxSupernodes(const std::vector<int>& parent, const std::vector<int>& colCount);
+	void scheduleSubtrees(std::vector<int>& roots, std::vector<int>& firstDesc, std::vector<char>& isTop)const;
+	void assembleRows(int s, int r0, int r1, Workspace& ws);
+	bool factorizeSupernode(int s, Workspace& ws);
+	bool factorizeSupernodeParallel(int s);
+	static bool factorizeDiagonal(BlockMap& Ls, int nCols);
+	static void solveOffDiagonal(BlockMap& Ls, int nCols, int r0, int r1);
+	int supernodeRows(int s)const { return m_rowStart[s + 1] - m_rowStart[s]; }
+	int supernodeCols(int s)const { return m_superStart[s + 1] - m_superStart[s]; }
+private:
+	Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> m_perm;	// new index of unknown i: m_perm.indices()[i]
+	SpMat m_ap;							// P * A * P^T, lower part
+
+	std::vector<int> m_superStart;		// the columns [m_superStart[s], m_superStart[s + 1]) form supernode s
+	std::vector<int> m_superOf;			// the supernode of each column
+	std::vector<int> m_superParent;		// the supernodal elimination tree, postordered
+	std::vector<int> m_rowStart;		// the sorted rows of supernode s: m_rows[m_rowStart[s], m_rowStart[s + 1])
+	std::vector<int> m_rows;
+	std::vector<size_t> m_valueStart;	// supernode s is a dense block at m_values[m_valueStart[s]], nRows x nCols
+	std::vector<Scalar> m_values;
+	int m_maxRows = 0;
+
+	// the descendants updating supernode s: m_updates[m_updateStart[s], m_updateStart[s + 1]), by ascending d.
+	// Precomputed instead of linked lists moving along during the factorization, so that independent subtrees
+	// can be factored concurrently
+	std::vector<int> m_updateStart;
+	std::vector<Update> m_updates;
+
+	int m_nThreads = 1;
+	Eigen::ComputationInfo m_info = Eigen::InvalidInput;
+};
+
+template<class Scalar>
+void SupernodalCholesky<Scalar>::analyzePattern(const SpMat& lowerA)
+{
+	const int n = (int)lowerA.rows();
+
+	// AMD, Eigen's ordering gives the inverse permutation
+	Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> pinv, perm;
+	{
+		SpMat C = lowerA.template selfadjointView<Eigen::Lower>();
+		Eigen::AMDOrdering<int> ordering;
+		ordering(C, pinv);
+	}
+	perm = pinv.inverse();
+
+	// the elimination tree of the AMD ordered matrix, then its postorder, so that the subtrees are contiguous
+	SpMat ap(n, n);
+	ap.template selfadjointView<Eigen::Upper>() = lowerA.template selfadjointView<Eigen::Lower>().twistedBy(perm);
+	std::vector<int> parent(n), ancestor(n);
+	for (int k = 0; k < n; k++)
+	{
+		parent[k] = -1;
+		ancestor[k] = -1;
+		for (typename SpMat::InnerIterator it(ap, k); it; ++it)
+		{
+			for (int i = (int)it.index(); i != -1 && i < k; )
+			{
+				const int next = ancestor[i];
+				ancestor[i] = k;
+				if (next == -1)
+					parent[i] = k;
+				i = next;
+			}
+		}
+	}
+	std::vector<int> childStart(n + 1, 0), children(n), post, stack;
+	for (int j = 0; j < n; j++)
+		if (parent[j] >= 0)
+			childStart[parent[j] + 1]++;
+	for (int j = 0; j < n; j++)
+		childStart[j + 1] += childStart[j];
+	std::vector<int> pos(childStart.begin(), childStart.end() - 1);
+	for (int j = 0; j < n; j++)
+		if (parent[j] >= 0)
+			children[pos[parent[j]]++] = j;
+	post.reserve(n);
+	for (int root = 0; root < n; root++)
+	{
+		if (parent[root] >= 0)
+			continue;
+		// iterative DFS, a node is emitted after all its children
+		stack.push_back(root);
+		pos[root] = childStart[root];
+		while (!stack.empty())
+		{
+			const int j = stack.back();
+			if (pos[j] < childStart[j + 1])
+			{
+				const int c = children[pos[j]++];
+				pos[c] = childStart[c];
+				stack.push_back(c);
+			}
+			else
+			{
+				post.push_back(j);
+				stack.pop_back();
+			}
+		}
+	}
+	m_perm.resize(n);
+	std::vector<int> ipost(n);
+	for (int k = 0; k < n; k++)
+		ipost[post[k]] = k;
+	for (int i = 0; i < n; i++)
+		m_perm.indices()[i] = ipost[perm.indices()[i]];
+
+	ap.template selfadjointView<Eigen::Upper>() = lowerA.template selfadjointView<Eigen::Lower>().twistedBy(m_perm);
+	symbolic(ap);
+	m_ap.resize(n, n);
+	m_ap.template selfadjointView<Eigen::Lower>() = lowerA.template selfadjointView<Eigen::Lower>().twistedBy(m_perm);
+	m_info = Eigen::Success;
+}
+
+template<class Scalar>
+void SupernodalCholesky<Scalar>::symbolic(const SpMat& upperAp)
+{
+	// elimination tree and column counts of the postordered matrix, by the row subtrees as in SimplicialCholesky
+	const int n = (int)upperAp.rows();
+	std::vector<int> parent(n), tags(n), colCount(n, 1);
+	for (int k = 0; k < n; k++)
+	{
+		parent[k] = -1;
+		tags[k] = k;
+		for (typename SpMat::InnerIterator it(upperAp, k); it; ++it)
+		{
+			int i = (int)it.index();
+			if (i >= k)
+				continue;
+			for (; tags[i] != k; i = parent[i])
+			{
+				if (parent[i] == -1)
+					parent[i] = k;
+				colCount[i]++;
+				tags[i] = k;
+			}
+		}
+	}
+	relaxSupernodes(parent, colCount);
+
+	// the rows of supernode s: its own columns, the rows of A below them, and the rows of its children below them
+	const int nSuper = getNumSupernodes();
+	std::vector<int> superParent(nSuper, -1), childStart(nSuper + 1, 0), children;
+	for (int s = 0; s < nSuper; s++)
+	{
+		const int p = parent[m_superStart[s + 1] - 1];
+		if (p >= 0)
+		{
+			superParent[s] = m_superOf[p];
+			childStart[superParent[s] + 1]++;
+		}
+	}
+	for (int s = 0; s < nSuper; s++)
+		childStart[s + 1] += childStart[s];
+	children.resize(childStart[nSuper]);
+	std::vector<int> pos(childStart.begin(), childStart.end() - 1);
+	for (int s = 0; s < nSuper; s++)
+		if (superParent[s] >= 0)
+			children[pos[superParent[s]]++] = s;
+
+	const SpMat lowerAp = upperAp.transpose();
+	std::fill(tags.begin(), tags.end(), -1);
+	m_rowStart.assign(nSuper + 1, 0);
+	m_rows.clear();
+	m_maxRows = 0;
+	for (int s = 0; s < nSuper; s++)
+	{
+		const int first = m_superStart[s], last = m_superStart[s + 1] - 1;
+		const size_t begin = m_rows.size();
+		for (int j = first; j <= last; j++)
+		{
+			m_rows.push_back(j);
+			tags[j] = s;
+		}
+		for (int j = first; j <= last; j++)
+		{
+			for (typename SpMat::InnerIterator it(lowerAp, j); it; ++it)
+			{
+				if (it.index() > last && tags[it.index()] != s)
+				{
+					tags[it.index()] = s;
+					m_rows.push_back((int)it.index());
+				}
+			}
+		}
+		for (int c = childStart[s]; c < childStart[s + 1]; c++)
+		{
+			for (int p = m_rowStart[children[c]]; p < m_rowStart[children[c] + 1]; p++)
+			{
+				const int i = m_rows[p];
+				if (i > last && tags[i] != s)
+				{
+					tags[i] = s;
+					m_rows.push_back(i);
+				}
+			}
+		}
+		std::sort(m_rows.begin() + begin, m_rows.end());
+		m_rowStart[s + 1] = (int)m_rows.size();
+		m_maxRows = std::max(m_maxRows, supernodeRows(s));
+	}
+
+	m_valueStart.assign(nSuper + 1, 0);
+	for (int s = 0; s < nSuper; s++)
+		m_valueStart[s + 1] = m_valueStart[s] + (size_t)supernodeRows(s) * supernodeCols(s);
+	m_values.resize(m_valueStart[nSuper]);
+
+	// the rows of d below its columns, grouped by the supernodes they fall into
+	m_updateStart.assign(nSuper + 1, 0);
+	for (int pass = 0; pass < 2; pass++)
+	{
+		for (int d = 0; d < nSuper; d++)
+		{
+			const int* rows = m_rows.data() + m_rowStart[d];
+			const int nRows = supernodeRows(d);
+			for (int p0 = supernodeCols(d), p1 = p0; p0 < nRows; p0 = p1)
+			{
+				const int s = m_superOf[rows[p0]];
+				while (p1 < nRows && m_superOf[rows[p1]] == s)
+					p1++;
+				if (pass == 0)
+					m_updateStart[s + 1]++;
+				else
+				{
+					Update& u = m_updates[pos[s]++];
+					u.d = d;
+					u.p0 = p0;
+					u.p1 = p1;
+				}
+			}
+		}
+		if (pass == 0)
+		{
+			for (int s = 0; s < nSuper; s++)
+				m_updateStart[s + 1] += m_updateStart[s];
+			m_updates.resize(m_updateStart[nSuper]);
+			pos.assign(m_updateStart.begin(), m_updateStart.end() - 1);
+		}
+	}
+	m_superParent.swap(superParent);
+}
+
+template<class Scalar>
+void SupernodalCholesky<Scalar>::relaxSupernodes(const std::vector<int>& parent, const std::vector<int>& colCount)
+{
+	// Grow each supernode along the chain j -> parent[j] = j + 1 while the explicit zeros stay few,
+	// with the thresholds of CHOLMOD: the structure of j below j + 1 is within that of j + 1, thus a supernode of
+	// columns [f, l] has the rows [f, l] and those of column l below it.
+	const int n = (int)parent.size();
+	m_superStart.clear();
+	m_superOf.resize(n);
+	int first = 0;
+	double nnz = colCount[0];
+	for (int j = 0; j < n; j++)
+	{
+		m_superOf[j] = (int)m_superStart.size();
+		bool merge = false;
+		if (j + 1 < n && parent[j] == j + 1)
+		{
+			const int nCols = j + 2 - first;
+			const int nRows = nCols + colCount[j + 1] - 1;
+			const double stored = double(nCols) * nRows - double(nCols) * (nCols - 1) / 2;
+			const double zeros = stored - (nnz + colCount[j + 1]);
+			const double ratio = zeros / stored;
+			merge = zeros == 0 || nCols <= 4 || (nCols <= 16 && ratio < 0.8) || (nCols <= 48 && ratio < 0.1)
+				|| ratio < 0.05;
+		}
+		if (!merge)
+		{
+			m_superStart.push_back(first);
+			first = j + 1;
+			nnz = 0;
+		}
+		if (j + 1 < n)
+			nnz += colCount[j + 1];
+	}
+	m_superStart.push_back(n);
+}
+
+template<class Scalar>
+void SupernodalCholesky<Scalar>::factorize(const SpMat& lowerA)
+{
+	const int nSuper = getNumSupernodes();
+	m_ap.template selfadjointView<Eigen::Lower>() = lowerA.template selfadjointView<Eigen::Lower>().twistedBy(m_perm);
+	std::fill(m_values.begin(), m_values.end(), Scalar(0));
+
+	m_info = Eigen::Success;
+	Workspace ws;
+	if (m_nThreads <= 1)
+	{
+		for (int s = 0; s < nSuper; s++)
+		{
+			if (!factorizeSupernode(s, ws))
+			{
+				m_info = Eigen::NumericalIssue;
+				return;
+			}
+		}
+		return;
+	}
+
+	// A supernode only needs its descendants, thus the independent subtrees are factored concurrently,
+	// the heaviest first, each by one thread in the serial order. The few supernodes above them are near the root
+	// and the largest ones, they follow one by one, each with its rows split among the threads
+	std::vector<int> roots, firstDesc;
+	std::vector<char> isTop;
+	scheduleSubtrees(roots, firstDesc, isTop);
+	bool ok = true;
+#pragma omp parallel num_threads(m_nThreads) reduction(&&: ok)
+	{
+		Workspace wsThread;
+#pragma omp for schedule(dynamic, 1)
+		for (int i = 0; i < (int)roots.size(); i++)
+		{
+			for (int s = firstDesc[roots[i]]; s <= roots[i] && ok; s++)
+				ok = factorizeSupernode(s, wsThread);
+		}
+	}
+	for (int s = 0; s < nSuper && ok; s++)
+	{
+		if (isTop[s])
+			ok = supernodeRows(s) >= PARALLEL_ROWS ? factorizeSupernodeParallel(s) : factorizeSupernode(s, ws);
+	}
+	if (!ok)
+		m_info = Eigen::NumericalIssue;
+}
+
+template<class Scalar>
+void SupernodalCholesky<Scalar>::scheduleSubtrees(std::vector<int>& roots, std::vector<int>& firstDesc,
+	std::vector<char>& isTop)const
+{
+	// the work of each subtree, by the dense flops of its supernodes, and its first supernode,
+	// the supernodes being postordered the subtree of s is [firstDesc[s], s]
+	const int nSuper = getNumSupernodes();
+	std::vector<double> work(nSuper);
+	firstDesc.resize(nSuper);
+	for (int s = 0; s < nSuper; s++)
+	{
+		work[s] = double(supernodeCols(s)) * supernodeRows(s) * supernodeRows(s);
+		firstDesc[s] = s;
+	}
+	for (int s = 0; s < nSuper; s++)
+	{
+		const int p = m_superParent[s];
+		if (p < 0)
+			continue;
+		work[p] += work[s];
+		firstDesc[p] = std::min(firstDesc[p], firstDesc[s]);
+	}
+	splitSubtrees(m_superParent.data(), nSuper, work, m_nThreads, roots, isTop);
+}
+
+template<class Scalar>
+void SupernodalCholesky<Scalar>::assembleRows(int s, int r0, int r1, Workspace& ws)
+{
+	// the rows [r0, r1) of supernode s: the columns of A, minus the updates of its descendants,
+	// only the parts of them falling into these rows
+	const int first = m_superStart[s], nCols = supernodeCols(s), nRows = supernodeRows(s);
+	const int* rows = m_rows.data() + m_rowStart[s];
+	BlockMap Ls(m_values.data() + m_valueStart[s], nRows, nCols);
+	const int rowBegin = rows[r0], rowEnd = r1 < nRows ? rows[r1] : rows[nRows - 1] + 1;
+
+	for (int j = 0; j < nCols; j++)
+	{
+		for (typename SpMat::InnerIterator it(m_ap, first + j); it; ++it)
+		{
+			const int i = (int)it.index();
+			if (i >= rowBegin && i < rowEnd)
+				Ls(int(std::lower_bound(rows + r0, rows + r1, i) - rows), j) += it.value();
+		}
+	}
+
+	// Ls -= Ld[a:b, :] * Ld[p0:p1, :]^T, the rows [a, b) of d being those among the rows [r0, r1) of s
+	for (int u = m_updateStart[s]; u < m_updateStart[s + 1]; u++)
+	{
+		const int d = m_updates[u].d, p0 = m_updates[u].p0, p1 = m_updates[u].p1;
+		const int dRows = supernodeRows(d), dCols = supernodeCols(d);
+		const int* rowsD = m_rows.data() + m_rowStart[d];
+		ConstBlockMap Ld(m_values.data() + m_valueStart[d], dRows, dCols);
+		const int a = int(std::lower_bound(rowsD + p0, rowsD + dRows, rowBegin) - rowsD);
+		const int b = int(std::lower_bound(rowsD + a, rowsD + dRows, rowEnd) - rowsD);
+		if (a == b)
+			continue;
+		const int m = b - a, k = p1 - p0;
+
+		// the local rows in s, the rows of d being a subset of those of s
+		if (ws.rel.size() < (size_t)m)
+			ws.rel.resize(m);
+		int* rel = ws.rel.data();
+		for (int i = 0, r = r0; i < m; i++)
+		{
+			r = int(std::lower_bound(rows + r, rows + r1, rowsD[a + i]) - rows);
+			rel[i] = r;
+		}
+
+		if (dCols < SMALL_COLS)
+		{
+			// the dense kernels do not pay off for the narrow ones, e.g. the leaves
+			for (int c = 0; c < k; c++)
+			{
+				Scalar* col = Ls.data() + (size_t)(rowsD[p0 + c] - first) * nRows;
+				const int i0 = std::max(a, p0 + c);
+				for (int t = 0; t < dCols; t++)
+				{
+					const Scalar* ld = Ld.data() + (size_t)t * dRows;
+					const Scalar l_ct = ld[p0 + c];
+					for (int i = i0; i < b; i++)
+						col[rel[i - a]] -= ld[i] * l_ct;
+				}
+			}
+			continue;
+		}
+
+		// the rows [a, top) are among the columns of s, only their lower triangle is needed
+		if (ws.update.size() < (size_t)m * k)
+			ws.update.resize((size_t)m * k);
+		BlockMap C(ws.update.data(), m, k);
+		const int top = std::max(a, std::min(b, p1));
+		if (a == p0 && top == p1)
+		{
+			C.topRows(k).template triangularView<Eigen::Lower>() =
+				Ld.middleRows(p0, k) * Ld.middleRows(p0, k).transpose();
+		}
+		else if (top > a)
+			C.topRows(top - a).noalias() = Ld.middleRows(a, top - a) * Ld.middleRows(p0, k).transpose();
+		if (b > top)
+			C.bottomRows(b - top).noalias() = Ld.middleRows(top, b - top) * Ld.middleRows(p0, k).transpose();
+		for (int c = 0; c < k; c++)
+		{
+			Scalar* col = Ls.data() + (size_t)(rowsD[p0 + c] - first) * nRows;
+			for (int i = std::max(a, p0 + c); i < b; i++)
+				col[rel[i - a]] -= C(i - a, c);
+		}
+	}
+}
+
+template<class Scalar>
+bool SupernodalCholesky<Scalar>::factorizeSupernode(int s, Workspace& ws)
+{
+	const int nCols = supernodeCols(s), nRows = supernodeRows(s);
+	BlockMap Ls(m_values.data() + m_valueStart[s], nRows, nCols);
+	assembleRows(s, 0, nRows, ws);
+	if (!factorizeDiagonal(Ls, nCols))
+		return false;
+	solveOffDiagonal(Ls, nCols, nCols, nRows);
+	return true;
+}
+
+template<class Scalar>
+bool SupernodalCholesky<Scalar>::factorizeSupernodeParallel(int s)
+{
+	// the updates and L21 = A21 * L11^-T by blocks of rows, the dense LL^T of L11 in between stays serial
+	const int nCols = supernodeCols(s), nRows = supernodeRows(s);
+	BlockMap Ls(m_values.data() + m_valueStart[s], nRows, nCols);
+	const int nBlocks = std::max(1, std::min(2 * m_nThreads, nRows / (PARALLEL_ROWS / 4)));
+#pragma omp parallel num_threads(m_nThreads)
+	{
+		Workspace ws;
+#pragma omp for schedule(dynamic, 1)
+		for (int i = 0; i < nBlocks; i++)
+			assembleRows(s, int((long long)nRows * i / nBlocks), int((long long)nRows * (i + 1) / nBlocks), ws);
+	}
+	if (!factorizeDiagonal(Ls, nCols))
+		return false;
+	const int m = nRows - nCols;
+#pragma omp parallel for schedule(dynamic, 1) num_threads(m_nThreads)
+	for (int i = 0; i < nBlocks; i++)
+		solveOffDiagonal(Ls, nCols, nCols + int((long long)m * i / nBlocks), nCols + int((long long)m * (i + 1) / nBlocks));
+	return true;
+}
+
+template<class Scalar>
+bool SupernodalCholesky<Scalar>::factorizeDiagonal(BlockMap& Ls, int nCols)
+{
+	const int nRows = (int)Ls.rows();
+	if (nCols >= SMALL_COLS)
+	{
+		Eigen::Ref<DenseMat> L11(Ls.topRows(nCols));
+		Eigen::LLT<Eigen::Ref<DenseMat>, Eigen::Lower> llt(L11);
+		return llt.info() == Eigen::Success;
+	}
+
+	// right-looking by columns
+	for (int j = 0; j < nCols; j++)
+	{
+		Scalar* lj = Ls.data() + (size_t)j * nRows;
+		if (!(lj[j] > Scalar(0)))
+			return false;
+		const Scalar d = std::sqrt(lj[j]);
+		lj[j] = d;
+		for (int i = j + 1; i < nCols; i++)
+			lj[i] /= d;
+		for (int c = j + 1; c < nCols; c++)
+		{
+			Scalar* lc = Ls.data() + (size_t)c * nRows;
+			const Scalar l_cj = lj[c];
+			for (int i = c; i < nCols; i++)
+				lc[i] -= lj[i] * l_cj;
+		}
+	}
+	return true;
+}
+
+template<class Scalar>
+void SupernodalCholesky<Scalar>::solveOffDiagonal(BlockMap& Ls, int nCols, int r0, int r1)
+{
+	// L21 = A21 * L11^-T for the rows [r0, r1)
+	if (r1 <= r0)
+		return;
+	const int nRows = (int)Ls.rows();
+	if (nCols >= SMALL_COLS)
+	{
+		Ls.topRows(nCols).template triangularView<Eigen::Lower>().transpose()
+			.template solveInPlace<Eigen::OnTheRight>(Ls.middleRows(r0, r1 - r0));
+		return;
+	}
+	for (int j = 0; j < nCols; j++)
+	{
+		Scalar* lj = Ls.data() + (size_t)j * nRows;
+		for (int t = 0; t < j; t++)
+		{
+			const Scalar* lt = Ls.data() + (size_t)t * nRows;
+			const Scalar l_jt = lt[j];
+			for (int i = r0; i < r1; i++)
+				lj[i] -= lt[i] * l_jt;
+		}
+		const Scalar d = lj[j];
+		for (int i = r0; i < r1; i++)
+			lj[i] /= d;
+	}
+}
+
+template<class Scalar>
+void SupernodalCholesky<Scalar>::solve(const DenseMat& B, DenseMatR& Y, DenseMat& X)const
+{
+	eigen_assert(m_info == Eigen::Success && "SupernodalCholesky not factorized");
+	const int n = rows();
+	const int nCols = (int)B.cols();
+	const int nSuper = getNumSupernodes();
+	const int* P = m_perm.indices().data();
+	Y.resize(n, nCols);
+	for (int i = 0; i < n; i++)
+		Y.row(P[i]) = B.row(i);
+	DenseMatR T(m_maxRows, nCols);
+
+	// L * Z = Y, block by block: Z_s = L11^-1 * Y_s, then Y_rows -= L21 * Z_s
+	for (int s = 0; s < nSuper; s++)
+	{
+		const int first = m_superStart[s], q = supernodeCols(s), m = supernodeRows(s) - q;
+		const int* rows = m_rows.data() + m_rowStart[s] + q;
+		ConstBlockMap Ls(m_values.data() + m_valueStart[s], m + q, q);
+		if (q < SMALL_COLS)
+		{
+			for (int j = 0; j < q; j++)
+			{
+				Scalar* yj = Y.data() + (size_t)(first + j) * nCols;
+				const Scalar* lj = Ls.data() + (size_t)j * (m + q);
+				for (int c = 0; c < nCols; c++)
+					yj[c] /= lj[j];
+				for (int i = j + 1; i < m + q; i++)
+				{
+					Scalar* yi = Y.data() + (size_t)(i < q ? first + i : rows[i - q]) * nCols;
+					for (int c = 0; c < nCols; c++)
+						yi[c] -= lj[i] * yj[c];
+				}
+			}
+			continue;
+		}
+		Ls.topRows(q).template triangularView<Eigen::Lower>().solveInPlace(Y.middleRows(first, q));
+		if (m == 0)
+			continue;
+		T.topRows(m).noalias() = Ls.bottomRows(m) * Y.middleRows(first, q);
+		for (int r = 0; r < m; r++)
+			Y.row(rows[r]) -= T.row(r);
+	}
+
+	// L^T * X = Z, backwards: X_s = L11^-T * (Z_s - L21^T * X_rows)
+	for (int s = nSuper - 1; s >= 0; s--)
+	{
+		const int first = m_superStart[s], q = supernodeCols(s), m = supernodeRows(s) - q;
+		const int* rows = m_rows.data() + m_rowStart[s] + q;
+		ConstBlockMap Ls(m_values.data() + m_valueStart[s], m + q, q);
+		if (q < SMALL_COLS)
+		{
+			for (int j = q - 1; j >= 0; j--)
+			{
+				Scalar* yj = Y.data() + (size_t)(first + j) * nCols;
+				const Scalar* lj = Ls.data() + (size_t)j * (m + q);
+				for (int i = j + 1; i < m + q; i++)
+				{
+					const Scalar* yi = Y.data() + (size_t)(i < q ? first + i : rows[i - q]) * nCols;
+					for (int c = 0; c < nCols; c++)
+						yj[c] -= lj[i] * yi[c];
+				}
+				for (int c = 0; c < nCols; c++)
+					yj[c] /= lj[j];
+			}
+			continue;
+		}
+		if (m > 0)
+		{
+			for (int r = 0; r < m; r++)
+				T.row(r) = Y.row(rows[r]);
+			Y.middleRows(first, q).noalias() -= Ls.bottomRows(m).transpose() * T.topRows(m);
+		}
+		Ls.topRows(q).transpose().template triangularView<Eigen::Upper>().solveInPlace(Y.middleRows(first, q));
+	}
+
+	X.resize(n, nCols);
+	for (int i = 0; i < n; i++)
+		X.row(i) = Y.row(P[i]);
+}
@@ -29,9 +29,17 @@ DEPENDPATH  += /usr/local/lib
 DEPENDPATH  += /usr/local/cuda//targets/x86_64-linux/lib64
 DEPENDPATH  += cudart
 
+# MeshTransfer and main.cpp use OpenMP for the per-face loops and the frames
+QMAKE_CXXFLAGS += -fopenmp
+LIBS += -fopenmp
+
 # Input
-HEADERS += algorithm/MeshTransfer.h \
+HEADERS += algorithm/CholeskyFactor.h \
+           algorithm/EliminationTree.h \
+           algorithm/MeshTransfer.h \
+           algorithm/MultigridPreconditioner.h \
            algorithm/ParameterConfig.h \
+           algorithm/SupernodalCholesky.h \
            algorithm/Renderable/bmesh.h \
            algorithm/Renderable/bmesh_private.h \
            algorithm/Renderable/ObjMesh.h \
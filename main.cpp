@@ -2,11 +2,15 @@
 //
 
 #include <stdio.h>
+#include <algorithm>
 #include "MeshTransfer.h"
 #include "Renderable/ObjMesh.h"
 #include <Eigen/Core>
 #include <omp.h>
 
+// print the per-frame cost of the transfer with and without the gradient emphasis, instead of transferring all meshes
+//#define BENCHMARK_GRADIENT_EMPHASIS
+
 static void objMeshGetFace(const ObjMesh& mesh, std::vector<MeshTransfer::Int3>& triangles)
 {
 	triangles.clear();
@@ -32,15 +36,74 @@ static void objMeshSetVerts(ObjMesh& mesh, const std::vector<MeshTransfer::Float
 		mesh.vertex_list[iVert] = Eigen::Vector3f(verts[iVert][0], verts[iVert][1], verts[iVert][2]);
 }
 
+// *.selection.txt: "num: n", then n lines of "face_index: w0 w1 w2 w3",
+// the barycentric weights of the vertices of a (quad) face of the mesh
+static bool loadSelection(const char* filename, const ObjMesh& mesh, std::vector<MeshTransfer::Landmark>& landmarks)
+{
+	FILE* pFile = fopen(filename, "r");
+	if (!pFile)
+		return false;
+	landmarks.clear();
+	int num = 0;
+	bool ok = fscanf(pFile, "num: %d\n", &num) == 1;
+	for (int i = 0; i < num && ok; i++)
+	{
+		int iFace = -1;
+		MeshTransfer::Landmark landmark;
+		ok = fscanf(pFile, "%d: %f %f %f %f\n", &iFace, &landmark.weights[0], &landmark.weights[1],
+			&landmark.weights[2], &landmark.weights[3]) == 5 && iFace >= 0 && iFace < (int)mesh.face_list.size();
+		if (!ok)
+			break;
+		const ObjMesh::obj_face& f = mesh.face_list[iFace];
+		for (int k = 0; k < 4; k++)
+		{
+			landmark.verts[k] = k < f.vertex_count ? f.vertex_index[k] : 0;
+			if (k >= f.vertex_count)
+				landmark.weights[k] = 0;
+		}
+		landmarks.push_back(landmark);
+	}
+	fclose(pFile);
+	return ok;
+}
+
+#ifdef BENCHMARK_GRADIENT_EMPHASIS
+// the emphasis refills and numerically refactors AtA for each frame, the unweighted transfer only solves
+static void benchmarkGradientEmphasis(const std::vector<MeshTransfer::Int3>& triangles,
+	const std::vector<MeshTransfer::Float3>& srcVerts0, const std::vector<MeshTransfer::Float3>& tarVerts0,
+	const std::vector<std::vector<MeshTransfer::Float3>>& srcVerts1)
+{
+	for (int emphasis = 0; emphasis < 2; emphasis++)
+	{
+		MeshTransfer transfer;
+		transfer.setGradientEmphasis(emphasis != 0);
+		double t0 = omp_get_wtime();
+		if (!transfer.init((int)triangles.size(), triangles.data(),
+			(int)srcVerts0.size(), srcVerts0.data(), tarVerts0.data()))
+		{
+			printf("%s\n", transfer.getErrString());
+			return;
+		}
+		double t1 = omp_get_wtime();
+		std::vector<MeshTransfer::Float3> tarVerts1;
+		for (size_t i = 0; i < srcVerts1.size(); i++)
+			transfer.transfer(srcVerts1[i], tarVerts1);
+		double t2 = omp_get_wtime();
+		printf("gradient emphasis %s: init %.1f ms, transfer %.1f ms per frame\n", emphasis ? "on" : "off",
+			(t1 - t0) * 1000, (t2 - t1) * 1000 / std::max((size_t)1, srcVerts1.size()));
+	}
+}
+#endif
+
 int main(int argc, const char* argv[])
 {
-	if (argc != 3 && argc != 4)
+	if (argc < 3 || argc > 5)
 	{
-		printf("Usage: dtransfer.exe [src_folder] [target0.obj] [result_folder]");
+		printf("Usage: dtransfer.exe [src_folder] [target0.obj] [result_folder] [landmarks.selection.txt]");
 		return -1;
 	}
 	ObjMesh srcMesh0, tarMesh0;
-	std::vector<MeshTransfer::Float3> srcVerts0, srcVerts1, tarVerts0;
+	std::vector<MeshTransfer::Float3> srcVerts0, tarVerts0;
 	std::vector<MeshTransfer::Int3> triangles;
 
 	std::string src_folder("mean/");
@@ -70,44 +133,80 @@ int main(int argc, const char* argv[])
 	objMeshGetVerts(srcMesh0, srcVerts0);
 	objMeshGetVerts(tarMesh0, tarVerts0);
 
-	enum {NUM_THREADS = 1};
-	MeshTransfer transfer[NUM_THREADS];
-		
-	for (int i = 0; i < NUM_THREADS; i++)
+	enum {NUM_THREADS = 4, NUM_MESHES = 47, BATCH_SIZE = 16};
+
+#ifdef BENCHMARK_GRADIENT_EMPHASIS
+	std::vector<std::vector<MeshTransfer::Float3>> benchVerts1;
+	for (int iMesh = 0; iMesh < BATCH_SIZE; iMesh++)
 	{
-		if (!transfer[i].init((int)triangles.size(), triangles.data(), 
-			(int)srcVerts0.size(), srcVerts0.data(), tarVerts0.data()))
+		ObjMesh srcMesh1;
+		if (!srcMesh1.loadObj((src_folder + std::to_string(iMesh) + ".obj").c_str(), false, false))
+			continue;
+		benchVerts1.push_back(std::vector<MeshTransfer::Float3>());
+		objMeshGetVerts(srcMesh1, benchVerts1.back());
+	}
+	benchmarkGradientEmphasis(triangles, srcVerts0, tarVerts0, benchVerts1);
+	return 0;
+#endif
+
+	// one shared factorized model, each thread only owns a lightweight workspace
+	MeshTransfer transfer;
+	std::vector<MeshTransfer::Workspace> workspaces(NUM_THREADS);
+
+	// the landmarks are pinned softly at their positions on target0
+	if (argc == 5)
+	{
+		std::vector<MeshTransfer::Landmark> landmarks;
+		if (!loadSelection(argv[4], tarMesh0, landmarks))
 		{
-			printf("[thread=%d]: %s\n", i, transfer[i].getErrString());
+			printf("Error, invalid selection file: %s\n", argv[4]);
 			return -1;
 		}
+		transfer.setLandmarks(landmarks);
+	}
+	if (!transfer.init((int)triangles.size(), triangles.data(), 
+		(int)srcVerts0.size(), srcVerts0.data(), tarVerts0.data()))
+	{
+		printf("%s\n", transfer.getErrString());
+		return -1;
 	}
 
+	// frames of a batch share the same pass over the factor
+	const int nBatches = (NUM_MESHES + BATCH_SIZE - 1) / BATCH_SIZE;
 #pragma omp parallel for num_threads(NUM_THREADS)
-	for (int iMesh = 0; iMesh < 47; iMesh++)
+	for (int iBatch = 0; iBatch < nBatches; iBatch++)
 	{
 		const int tid = omp_get_thread_num();
 
-		ObjMesh tarMesh1, srcMesh1;
-		std::vector<MeshTransfer::Float3> tarVerts1;
-		tarMesh1.cloneFrom(&tarMesh0);
-
-		std::string sourceMeshName(src_folder + std::to_string(iMesh) + ".obj");
-		if (!srcMesh1.loadObj(sourceMeshName.c_str(), false, false))
+		std::vector<int> meshIds;
+		std::vector<std::vector<MeshTransfer::Float3>> srcVerts1, tarVerts1;
+		for (int iMesh = iBatch * BATCH_SIZE; iMesh < std::min((iBatch + 1) * BATCH_SIZE, (int)NUM_MESHES); iMesh++)
 		{
-			printf("warning, source mesh not found: %s\n", sourceMeshName.c_str());
-			continue;
+			ObjMesh srcMesh1;
+			std::string sourceMeshName(src_folder + std::to_string(iMesh) + ".obj");
+			if (!srcMesh1.loadObj(sourceMeshName.c_str(), false, false))
+			{
+				printf("warning, source mesh not found: %s\n", sourceMeshName.c_str());
+				continue;
+			}
+			meshIds.push_back(iMesh);
+			srcVerts1.push_back(std::vector<MeshTransfer::Float3>());
+			objMeshGetVerts(srcMesh1, srcVerts1.back());
 		}
 
-		objMeshGetVerts(srcMesh1, srcVerts1);
-		if (!transfer[tid].transfer(srcVerts1, tarVerts1))
+		if (!transfer.transferBatch(srcVerts1, tarVerts1, workspaces[tid]))
 		{
-			printf("%s\n", transfer[tid].getErrString());
+			printf("[thread=%d]: %s\n", tid, workspaces[tid].errStr.c_str());
 			continue;
 		}
-		objMeshSetVerts(tarMesh1, tarVerts1);
 
-		tarMesh1.saveObj((result_folder + std::to_string(iMesh) + ".obj").c_str());
+		for (size_t i = 0; i < meshIds.size(); i++)
+		{
+			ObjMesh tarMesh1;
+			tarMesh1.cloneFrom(&tarMesh0);
+			objMeshSetVerts(tarMesh1, tarVerts1[i]);
+			tarMesh1.saveObj((result_folder + std::to_string(meshIds[i]) + ".obj").c_str());
+		}
 	}
 
     return 0;